@@ -0,0 +1,1635 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <LeptonCommon.h>
+#include <LeptonAPI.h>
+#include <LeptonCamera.h>
+#include <LeptonCameraGroup.h>
+#include <LeptonRecorder.h>
+#include <LeptonReplay.h>
+#include <LeptonSimulator.h>
+#include <LeptonUnpack.h>
+#include <Connection.h>
+#include <ConnectionCommon.h>
+#include <FrameCodec.h>
+#include <FramePublisher.h>
+#include <MessageServer.h>
+#ifdef LEPTON_I2C_DEV
+#include <LEPTON_I2C_Reg.h>
+#include <LEPTON_SDK.h>
+#include <LEPTON_SYS.h>
+#include <raspi_I2C.h>
+#endif
+
+// C/C++
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <ctime>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#ifdef LEPTON_I2C_DEV
+#include <cerrno>
+#include <cstdio>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#endif
+
+
+// Heap allocations made by the app (all threads), see BenchmarkAlloc
+std::atomic<uint64_t> heap_allocations{0};
+
+void* operator new(size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+
+/**
+ * @brief Print app usage
+ */
+void PrintUsage() {
+    std::cout << "Usage: LePiBenchmark capture [lepton2|lepton3] [frames] [throttle|fast] [desync_rate] [packet|bulk] [timed|vsync] [off|header|footer]" << std::endl
+              << "       LePiBenchmark camera [lepton2|lepton3] [seconds] [consumers] [copy|lease] [i2c_time_us]" << std::endl
+              << "       LePiBenchmark ring [lepton2|lepton3] [seconds] [drop|block] [slow_delay_ms]" << std::endl
+              << "       LePiBenchmark unpack [lepton2|lepton3] [iterations]" << std::endl
+              << "       LePiBenchmark alloc [lepton2|lepton3] [frames]" << std::endl
+              << "       LePiBenchmark resync [lepton2|lepton3] [seconds] [load_threads] [default|rt]" << std::endl
+              << "       LePiBenchmark group [lepton2|lepton3] [cameras] [seconds] [max_skew_us]" << std::endl
+              << "       LePiBenchmark record [lepton2|lepton3] [seconds] [path] [throttle|fast] [segment_frames]" << std::endl
+              << "       LePiBenchmark replay [path] [seconds] [throttle|fast] [speed]" << std::endl
+              << "       LePiBenchmark codec [lepton2|lepton3] [frames] [iterations]" << std::endl
+              << "       LePiBenchmark stop [lepton2|lepton3] [desync_rate] [seconds] [max_stop_ms]" << std::endl
+              << "       LePiBenchmark i2c [transactions]" << std::endl
+              << "       LePiBenchmark serve [clients] [seconds] [slow_delay_ms] [server_ip] [request|push] [credits] [u8|u16|compressed]" << std::endl
+              << "\t- capture: read frames from a simulated sensor, using LePi serial interface" << std::endl
+              << "\t- camera: stream frames from a simulated sensor, using LePi parallel interface" << std::endl
+              << "\t- ring: fast and slow subscribers reading every frame from the camera ring" << std::endl
+              << "\t- unpack: VoSPI packets to U16/U8 frame conversion" << std::endl
+              << "\t- alloc: heap allocations of the steady state capture and serve loop (must be 0)" << std::endl
+              << "\t- resync: camera resyncs under CPU load, with default or real time grabber settings" << std::endl
+              << "\t- group: synchronized frame sets of several simulated sensors, captured together" << std::endl
+              << "\t- record: record a simulated sensor to segment files, and find every frame back" << std::endl
+              << "\t- replay: run a recording through the camera, at recorded/scaled rate or unthrottled" << std::endl
+              << "\t- codec: lossless U16 frame compression ratio and encode/decode throughput" << std::endl
+              << "\t- stop: camera stop time while the grabber can't sync (must be under max_stop_ms)" << std::endl
+              << "\t- i2c: i2c-dev I2C driver and LEP_I2C transactions against a fake CCI bus master (i2c-dev backend only)" << std::endl
+              << "\t- serve: frame rate of several LePiServer clients (one of them slow)" << std::endl;
+}
+
+/**
+ * @brief Print the capture path statistics, as seen by LePi
+ */
+void PrintStatistics(const LeptonStatistics& stats) {
+    std::cout << "LePi statistics:" << std::endl
+              << "\t- frames:             " << stats.frames << std::endl
+              << "\t- discard packets:    " << stats.discard_packets << std::endl
+              << "\t- packet mismatches:  " << stats.packet_mismatches << std::endl
+              << "\t- segment mismatches: " << stats.segment_mismatches << std::endl
+              << "\t- SPI resets:         " << stats.spi_resets << std::endl
+              << "\t- reboots:            " << stats.reboots << std::endl
+              << "\t- duplicate frames:   " << stats.duplicate_frames << std::endl
+              << "\t- mean latency:       "
+              << (stats.frames ? stats.latency_sum / stats.frames : 0) << " us" << std::endl
+              << "\t- latency histogram:  ";
+    for (size_t i = 0; i < kLatencyBuckets; ++i) {
+        if (i < kLatencyBuckets - 1) {
+            std::cout << "<=" << kLatencyBucketBounds[i] / 1000 << "ms:";
+        }
+        else {
+            std::cout << ">" << kLatencyBucketBounds[i - 1] / 1000 << "ms:";
+        }
+        std::cout << stats.latency[i] << " ";
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * @brief Capture benchmark: throughput and resyncs of the VoSPI capture path
+ */
+int BenchmarkCapture(int argc, char** argv) {
+
+    // Simulated sensor settings
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    const int num_frames{argc > 3 ? atoi(argv[3]) : 100};
+    sim_config.throttle = !(argc > 4 && std::string(argv[4]) == "fast");
+    sim_config.desync_rate = argc > 5 ? atof(argv[5]) : 0.0;
+    LeptonCaptureOptions options;
+    options.read_mode = (argc > 6 && std::string(argv[6]) == "bulk") ? READ_BULK : READ_PACKET;
+    options.vsync = argc > 7 && std::string(argv[7]) == "vsync";
+    const std::string telemetry{argc > 8 ? argv[8] : "off"};
+    options.telemetry = telemetry == "header" ? TELEMETRY_HEADER :
+                        telemetry == "footer" ? TELEMETRY_FOOTER : TELEMETRY_OFF;
+
+    // Init sensor
+    auto simulator = std::make_shared<LeptonSimulator>(sim_config);
+    LePi lePi(simulator, options);
+    if (!lePi.OpenConnection()) {
+        std::cerr << "Unable to open communication with the sensor" << std::endl;
+        return EXIT_FAILURE;
+    }
+    LeptonCameraConfig lp_config(lePi.GetType());
+    std::vector<uint16_t> frame(lp_config.width * lp_config.height);
+
+    // Grab frames, and check the telemetry frame counter (one unique frame
+    // every 3 VoSPI frames)
+    LeptonFrameMetadata metadata;
+    uint32_t first_counter{0};
+    uint64_t counter_gaps{0};
+    const std::clock_t cpu_start{std::clock()};
+    auto tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_frames; ++i) {
+        const uint32_t previous_counter{metadata.frame_counter};
+        lePi.GetFrame(frame.data(), FRAME_U16, &metadata);
+        if (i == 0) {
+            first_counter = metadata.frame_counter;
+        }
+        else if (metadata.frame_counter != previous_counter + 3) {
+            ++counter_gaps;
+        }
+    }
+    auto tEnd = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(tEnd - tStart).count();
+    const double cpu_time{static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC};
+
+    // Report
+    std::cout << "Sensor:          " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3")
+              << (sim_config.throttle ? " (throttled)" : " (unthrottled)") << std::endl
+              << "Read mode:       " << (options.read_mode == READ_BULK ? "bulk" : "packet") << std::endl
+              << "Sync:            " << (options.vsync ? "vsync" : "timed") << std::endl
+              << "Telemetry:       " << telemetry << std::endl
+              << "Frames:          " << num_frames << std::endl
+              << "Elapsed:         " << elapsed << " s" << std::endl
+              << "FPS:             " << num_frames / elapsed << std::endl
+              << "CPU time:        " << cpu_time << " s" << std::endl
+              << "Packets read:    " << simulator->PacketsRead() << std::endl
+              << "SPI transfers:   " << simulator->SPITransfers() << std::endl
+              << "Discard packets: " << simulator->DiscardPackets() << std::endl
+              << "Desyncs:         " << simulator->DesyncsInjected() << std::endl
+              << "VSYNC edges:     " << simulator->VsyncEdges() << std::endl
+              << "SPI resets:      " << simulator->SPIOpenCount() - 1 << std::endl
+              << "Reboots:         " << simulator->RebootCount() << std::endl;
+    if (metadata.valid) {
+        std::cout << "Frame counter:   " << first_counter << " -> " << metadata.frame_counter
+                  << " (" << counter_gaps << " gaps)" << std::endl
+                  << "FPA temperature: " << metadata.fpa_temperature / 100.0 << " K" << std::endl
+                  << "FFC state:       " << metadata.ffc_state << std::endl;
+    }
+    PrintStatistics(lePi.GetStatistics());
+
+    // Release sensor
+    if (!lePi.CloseConnection()) {
+        std::cerr << "Unable to close communication with the sensor" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Camera benchmark: grabber thread resyncs while consumers read frames
+ */
+int BenchmarkCamera(int argc, char** argv) {
+
+    // Simulated sensor settings (real time pacing)
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    const int seconds{argc > 3 ? atoi(argv[3]) : 5};
+    const int num_consumers{argc > 4 ? atoi(argv[4]) : 1};
+    const bool lease{argc > 5 && std::string(argv[5]) == "lease"};
+    sim_config.i2c_time = argc > 6 ? atoi(argv[6]) : 0;
+
+    // Open camera
+    auto simulator = std::make_shared<LeptonSimulator>(sim_config);
+    LeptonCamera cam(simulator);
+    cam.start();
+
+    // Consumers sleep until a frame is published
+    const std::clock_t cpu_start{std::clock()};
+    std::atomic<bool> run{true};
+    std::atomic<uint64_t> frames_read{0};
+    std::atomic<uint64_t> lease_errors{0};
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < num_consumers; ++i) {
+        consumers.emplace_back([&]() {
+            std::vector<uint8_t> frame(cam.width() * cam.height());
+            while (run) {
+                if (!cam.waitForFrame(std::chrono::milliseconds(100))) {
+                    continue;
+                }
+                if (lease) {
+                    // Hold the frame for a while, it must not change meanwhile
+                    auto leased = cam.leaseFrame();
+                    const uint64_t sum{std::accumulate(leased->pixels.begin(), leased->pixels.end(), 0ull)};
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    if (sum != std::accumulate(leased->pixels.begin(), leased->pixels.end(), 0ull)) {
+                        ++lease_errors;
+                    }
+                }
+                else {
+                    cam.getFrameU8(frame);
+                }
+                ++frames_read;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    run = false;
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    cam.stop();
+    const double cpu_time{static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC};
+
+    // Report
+    std::cout << "Sensor:      " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Consumers:   " << num_consumers << (lease ? " (lease)" : " (copy)") << std::endl
+              << "CPU time:    " << cpu_time << " s (" << 100.0 * cpu_time / seconds << "% of one core)" << std::endl
+              << "Frames read: " << frames_read << " (" << frames_read / static_cast<double>(seconds) << " fps)" << std::endl
+              << "Lease errors: " << lease_errors << std::endl
+              << "Sensor temp: " << cam.SensorTemperature() / 100.0 << " K" << std::endl
+              << "SPI resets:  " << simulator->SPIOpenCount() - 1 << std::endl
+              << "Reboots:     " << simulator->RebootCount() << std::endl;
+    PrintStatistics(cam.statistics());
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Ring benchmark: a fast and a slow subscriber read the camera frame
+ *        stream, with the given backpressure policy
+ */
+int BenchmarkRing(int argc, char** argv) {
+
+    // Simulated sensor settings (real time pacing)
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    const int seconds{argc > 3 ? atoi(argv[3]) : 5};
+    const LeptonRingPolicy policy{(argc > 4 && std::string(argv[4]) == "block") ? RING_BLOCK : RING_DROP_OLDEST};
+    const int slow_delay_ms{argc > 5 ? atoi(argv[5]) : 200};
+
+    // Open camera
+    auto simulator = std::make_shared<LeptonSimulator>(sim_config);
+    LeptonCamera cam(simulator);
+    auto fast = cam.subscribe(policy);
+    auto slow = cam.subscribe(policy);
+    cam.start();
+
+    // Subscriber loop, counts frames, frame id gaps and capture to read latency
+    struct Result {
+        uint64_t frames{0};
+        uint64_t gaps{0};
+        double latency_us{0.0};
+    };
+    std::atomic<bool> run{true};
+    auto consume = [&](LeptonFrameSubscriber& subscriber, int delay_ms, Result& result) {
+        LeptonFrame frame;
+        uint64_t last_id{0};
+        while (run) {
+            if (!subscriber.read(frame, std::chrono::milliseconds(100))) {
+                continue;
+            }
+            const uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            if (result.frames > 0 && frame.frame_id != last_id + 1) {
+                ++result.gaps;
+            }
+            last_id = frame.frame_id;
+            result.latency_us += now - frame.timestamp;
+            ++result.frames;
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        }
+    };
+    Result fast_result;
+    Result slow_result;
+    std::thread fast_thread(consume, std::ref(*fast), 0, std::ref(fast_result));
+    std::thread slow_thread(consume, std::ref(*slow), slow_delay_ms, std::ref(slow_result));
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    run = false;
+    fast_thread.join();
+    slow_thread.join();
+    cam.stop();
+
+    // Report
+    auto report = [&](const char* name, const Result& result, LeptonFrameSubscriber& subscriber) {
+        std::cout << name << result.frames << " frames ("
+                  << result.frames / static_cast<double>(seconds) << " fps), "
+                  << subscriber.dropped() << " dropped, "
+                  << result.gaps << " gaps, "
+                  << (result.frames ? result.latency_us / result.frames : 0.0) << " us latency" << std::endl;
+    };
+    std::cout << "Sensor:      " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Policy:      " << (policy == RING_BLOCK ? "block" : "drop oldest") << std::endl;
+    report("Fast:        ", fast_result, *fast);
+    report("Slow:        ", slow_result, *slow);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Per byte unpack loop, used by LePi before the packet based kernels
+ *        (kept as benchmark baseline)
+ */
+void UnpackFrame16Baseline(const uint8_t* src, uint32_t frame_size,
+                           uint32_t packet_size, uint16_t* frame) {
+    auto dst = reinterpret_cast<uint8_t *>(frame);
+    int idx = 0;
+    for(uint32_t i = 0; i < frame_size; i+=2) {
+
+        // Skip the first 2 uint16_t's of every packet, they're 4 header bytes
+        if(i % packet_size < 4) {
+            continue;
+        }
+
+        // Flip the MSB and LSB
+        dst[idx++] = src[i+1];
+        dst[idx++] = src[i];
+    }
+}
+
+/**
+ * @brief Two pass U8 unpack (in place byte swap + min/max, then float scale),
+ *        used by LePi before the fused kernel (kept as benchmark baseline)
+ */
+void UnpackFrame8Baseline(uint8_t* src, uint32_t frame_size,
+                          uint32_t packet_size, uint8_t* frame) {
+    auto frame_u16 = reinterpret_cast<uint16_t *>(src);
+    const uint32_t frame_size_uint16{frame_size / 2};
+    const uint32_t packet_size_uint16{packet_size / 2};
+
+    // Compute min and max
+    uint16_t minValue = 65535;
+    uint16_t maxValue = 0;
+    for(uint32_t i = 0; i < frame_size_uint16; i++) {
+        if(i % packet_size_uint16 < 2) {
+            continue;
+        }
+        uint8_t temp = src[i*2];
+        src[i*2] = src[i*2+1];
+        src[i*2+1] = temp;
+        uint16_t value = frame_u16[i];
+        if(value > maxValue) {
+            maxValue = value;
+        }
+        if(value < minValue) {
+            minValue = value;
+        }
+    }
+
+    // Scale frame range
+    float scale = 255.f / static_cast<float>(maxValue - minValue);
+    int idx = 0;
+    for(uint32_t i = 0; i < frame_size_uint16; i++) {
+        if(i % packet_size_uint16 < 2) {
+            continue;
+        }
+        frame[idx++] = static_cast<uint8_t>((frame_u16[i] - minValue) * scale);
+    }
+}
+
+/**
+ * @brief Unpack benchmark: VoSPI packets to U16/U8 frame, baseline vs. kernels
+ */
+int BenchmarkUnpack(int argc, char** argv) {
+
+    const LeptonType type{(argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3};
+    const int iterations{argc > 3 ? atoi(argv[3]) : 10000};
+    LeptonCameraConfig lp_config(type);
+    const uint32_t num_packets{static_cast<uint32_t>(lp_config.segments_per_frame) *
+                               lp_config.packets_per_segment};
+    const uint32_t frame_size{num_packets * lp_config.packet_size};
+
+    // Random VoSPI packets
+    std::vector<uint8_t> packets(frame_size);
+    std::mt19937 rng(1);
+    for (auto& byte : packets) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    std::vector<uint16_t> frame_ref(lp_config.width * lp_config.height);
+    std::vector<uint16_t> frame(lp_config.width * lp_config.height);
+
+    // Time a frame unpack function
+    auto run = [&](const char* name, std::vector<uint16_t>& out,
+                   void (*unpack)(const uint8_t*, uint32_t, uint32_t, uint16_t*)) {
+        auto tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            unpack(packets.data(), num_packets, lp_config.packet_size, out.data());
+        }
+        auto tEnd = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double, std::micro>(tEnd - tStart).count();
+        std::cout << name << elapsed / iterations << " us/frame" << std::endl;
+    };
+
+    // Baseline
+    auto tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        UnpackFrame16Baseline(packets.data(), frame_size, lp_config.packet_size, frame_ref.data());
+    }
+    auto tEnd = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double, std::micro>(tEnd - tStart).count();
+    std::cout << "Sensor:   " << (type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Baseline: " << elapsed / iterations << " us/frame" << std::endl;
+
+    // Kernels
+    run("Scalar:   ", frame, LeptonUnpack16Scalar);
+    if (frame != frame_ref) {
+        std::cerr << "Scalar kernel output mismatch" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::fill(frame.begin(), frame.end(), 0);
+    std::string kernel_name{LeptonUnpackKernel()};
+    kernel_name.resize(10, ' ');
+    kernel_name[kernel_name.find(' ')] = ':';
+    run(kernel_name.c_str(), frame, LeptonUnpack16);
+    if (frame != frame_ref) {
+        std::cerr << "SIMD kernel output mismatch" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // U8 baseline (byte swaps in place, so it runs on a copy of the packets)
+    std::vector<uint8_t> packets_copy(packets);
+    std::vector<uint8_t> frame8_ref(lp_config.width * lp_config.height);
+    std::vector<uint8_t> frame8(lp_config.width * lp_config.height);
+    tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        std::copy(packets.begin(), packets.end(), packets_copy.begin());
+        UnpackFrame8Baseline(packets_copy.data(), frame_size, lp_config.packet_size, frame8_ref.data());
+    }
+    tEnd = std::chrono::steady_clock::now();
+    elapsed = std::chrono::duration<double, std::micro>(tEnd - tStart).count();
+    std::cout << "U8 baseline: " << elapsed / iterations << " us/frame (packets copy included)" << std::endl;
+
+    // U8 fused unpack + min/max, then fixed point scale
+    uint16_t minValue{0};
+    uint16_t maxValue{0};
+    tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        LeptonUnpack16MinMax(packets.data(), num_packets, lp_config.packet_size,
+                             frame.data(), minValue, maxValue);
+        LeptonScale8(frame.data(), frame.size(), minValue, maxValue, frame8.data());
+    }
+    tEnd = std::chrono::steady_clock::now();
+    elapsed = std::chrono::duration<double, std::micro>(tEnd - tStart).count();
+    std::cout << "U8 fused:    " << elapsed / iterations << " us/frame" << std::endl;
+    for (size_t i = 0; i < frame8.size(); ++i) {
+        if (std::abs(frame8[i] - frame8_ref[i]) > 1) {
+            std::cerr << "U8 fused kernel output mismatch" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Flat scene must not divide by zero
+    std::fill(frame.begin(), frame.end(), 8000);
+    LeptonMinMax(frame.data(), frame.size(), minValue, maxValue);
+    LeptonScale8(frame.data(), frame.size(), minValue, maxValue, frame8.data());
+    if (minValue != 8000 || maxValue != 8000 ||
+        std::count(frame8.begin(), frame8.end(), 0) != static_cast<long>(frame8.size())) {
+        std::cerr << "U8 flat frame scaling failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Camera group benchmark: several simulated sensors, each with its own
+ *        grabber thread, read as synchronized frame sets
+ */
+int BenchmarkGroup(int argc, char** argv) {
+
+    // Simulated sensor settings (real frame rate)
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    const int num_cameras{argc > 3 ? atoi(argv[3]) : 2};
+    const int seconds{argc > 4 ? atoi(argv[4]) : 5};
+    const uint32_t max_skew{argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : kLeptonGroupMaxSkew};
+
+    // One camera per chip select, each with its own transport
+    std::vector<std::shared_ptr<LeptonCamera>> cameras;
+    for (int i = 0; i < num_cameras; ++i) {
+        LeptonCaptureOptions options;
+        options.spi_port = i;
+        cameras.push_back(std::make_shared<LeptonCamera>(
+            std::make_shared<LeptonSimulator>(sim_config), options));
+
+        // The sensors do not start in phase
+        std::this_thread::sleep_for(std::chrono::milliseconds(13 * i));
+    }
+    LeptonCameraGroup group(cameras, max_skew);
+    group.start();
+
+    // Read frame sets
+    std::vector<LeptonFrame> frames;
+    uint64_t timeouts{0};
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        if (!group.read(frames, std::chrono::milliseconds(1000))) {
+            ++timeouts;
+        }
+    }
+    group.stop();
+
+    // Report
+    const LeptonGroupStatistics stats{group.statistics()};
+    std::cout << "Sensor:      " << num_cameras << " x "
+              << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Frame sets:  " << stats.frame_sets << " ("
+              << stats.frame_sets / static_cast<double>(seconds) << " sets/s), "
+              << timeouts << " timeouts" << std::endl
+              << "Skew:        mean " << (stats.frame_sets ? stats.skew_sum / stats.frame_sets : 0)
+              << " us, max " << stats.max_skew << " us (limit " << max_skew << " us)" << std::endl;
+    for (int i = 0; i < num_cameras; ++i) {
+        std::cout << "Camera " << i << ":    " << stats.skipped_frames[i] << " skipped, "
+                  << stats.dropped_frames[i] << " dropped, "
+                  << group.camera(i)->statistics().frames << " captured" << std::endl;
+    }
+
+    if (stats.frame_sets == 0 || stats.max_skew > max_skew) {
+        std::cerr << "Camera group out of sync" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Recorder benchmark: records a simulated sensor to segment files,
+ *        then reads them back and checks every frame can be found by id and
+ *        capture time
+ */
+int BenchmarkRecord(int argc, char** argv) {
+
+    // Simulated sensor settings
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    const int seconds{argc > 3 ? atoi(argv[3]) : 5};
+    LeptonRecorderOptions rec_options;
+    rec_options.path = argc > 4 ? argv[4] : "/tmp/lepi_record";
+    sim_config.throttle = !(argc > 5 && std::string(argv[5]) == "fast");
+    rec_options.segment_frames = argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 256;
+
+    // Record
+    LeptonCamera camera(std::make_shared<LeptonSimulator>(sim_config));
+    LeptonRecorder recorder(camera, rec_options);
+    camera.start();
+    recorder.start();
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    recorder.stop();
+    const double elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    camera.stop();
+    const LeptonRecorderStatistics stats{recorder.statistics()};
+
+    // Read back: each frame found by id and capture time
+    uint64_t frames{0};
+    uint64_t errors{0};
+    double lookup_time{0.0};
+    for (uint32_t segment = 0; segment < stats.segments; ++segment) {
+        LeptonRecordReader reader(recorder.segmentPath(segment));
+        const auto lookup_start = std::chrono::steady_clock::now();
+        for (size_t slot = 0; slot < reader.size(); ++slot) {
+            const LeptonRecordEntry& entry = reader.entry(slot);
+            if (!(entry.flags & kRecordValid)) {
+                continue;
+            }
+            ++frames;
+            if (reader.findFrameId(entry.frame_id) != static_cast<int64_t>(slot) ||
+                reader.findTimestamp(entry.timestamp) != static_cast<int64_t>(slot)) {
+                ++errors;
+            }
+        }
+        lookup_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - lookup_start).count();
+    }
+
+    // Report
+    std::cout << "Sensor:      " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3")
+              << (sim_config.throttle ? " (throttled)" : " (unthrottled)") << std::endl
+              << "Recorded:    " << stats.frames << " frames (" << stats.frames / elapsed
+              << " fps), " << stats.dropped << " dropped, "
+              << stats.bytes / elapsed / 1e6 << " MB/s" << std::endl
+              << "Segments:    " << stats.segments << " x " << rec_options.segment_frames
+              << " frames (" << rec_options.path << "_*" << kRecordExtension << ")" << std::endl
+              << "Read back:   " << frames << " frames, " << errors << " lookup errors, "
+              << (frames ? lookup_time / frames * 1e9 : 0.0) << " ns per id+time lookup" << std::endl;
+
+    if (stats.failed || frames != stats.frames || errors > 0) {
+        std::cerr << "Recording check failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Replay benchmark: runs a recording through LeptonCamera, and checks
+ *        the camera delivers the recorded frames, in order, and throttled, at
+ *        the recorded frame rate scaled by the speed
+ */
+int BenchmarkReplay(int argc, char** argv) {
+
+    // Replay settings
+    LeptonReplayConfig replay_config;
+    replay_config.path = argc > 2 ? argv[2] : "/tmp/lepi_record";
+    const int seconds{argc > 3 ? atoi(argv[3]) : 5};
+    replay_config.throttle = !(argc > 4 && std::string(argv[4]) == "fast");
+    replay_config.speed = argc > 5 ? atof(argv[5]) : 1.0;
+
+    // Recorded frames, in order (pixels checksum)
+    auto checksum = [](const uint16_t* pixels, size_t size) {
+        uint64_t hash{14695981039346656037ull};
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ pixels[i]) * 1099511628211ull;
+        }
+        return hash;
+    };
+    std::vector<uint64_t> recorded;
+    uint64_t first_timestamp{0};
+    uint64_t last_timestamp{0};
+    for (uint32_t segment = 0; ; ++segment) {
+        const std::string path{LeptonRecordSegmentPath(replay_config.path, segment)};
+        if (access(path.c_str(), F_OK) != 0) {
+            break;
+        }
+        LeptonRecordReader reader(path);
+        for (size_t slot = 0; slot < reader.size(); ++slot) {
+            if (reader.entry(slot).flags & kRecordValid) {
+                recorded.push_back(checksum(reader.pixels(slot), reader.width() * reader.height()));
+                first_timestamp = recorded.size() == 1 ? reader.entry(slot).timestamp : first_timestamp;
+                last_timestamp = reader.entry(slot).timestamp;
+            }
+        }
+    }
+
+    // Replay, every frame read by a blocking subscriber
+    auto replay = std::make_shared<LeptonReplay>(replay_config);
+    LeptonCamera cam(replay);
+    auto subscriber = cam.subscribe(RING_BLOCK);
+    cam.start();
+    LeptonFrame frame;
+    uint64_t frames{0};
+    uint64_t replayed{0};   // recorded frames delivered, in order
+    uint64_t first_capture{0};
+    uint64_t last_capture{0};
+    uint64_t unexpected{0};
+    size_t next{0};     // next recorded frame expected (the current one may repeat)
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        if (!subscriber->read(frame, std::chrono::milliseconds(100))) {
+            continue;
+        }
+        const uint64_t hash{checksum(frame.pixels.data(), frame.pixels.size())};
+        const size_t current{(next + recorded.size() - 1) % recorded.size()};
+        if (frames > 0 && hash == recorded[current]) {
+            ++frames;
+            continue;
+        }
+
+        // Throttled, the frames the recorder lost are skipped: look ahead
+        size_t found{next};
+        const size_t look_ahead{replay_config.throttle ? recorded.size() : 1};
+        for (size_t i = 0; i < look_ahead && recorded[found] != hash; ++i) {
+            found = (found + 1) % recorded.size();
+        }
+        if (recorded[found] == hash) {
+            next = (found + 1) % recorded.size();
+            first_capture = replayed++ == 0 ? frame.timestamp : first_capture;
+            last_capture = frame.timestamp;
+        }
+        else {
+            ++unexpected;
+        }
+        ++frames;
+    }
+    const double elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    cam.stop();
+
+    // Throttled, the recorded frame rate is kept (scaled by the speed)
+    const double recorded_fps{last_timestamp > first_timestamp ?
+        (recorded.size() - 1) * 1e6 / (last_timestamp - first_timestamp) : 0.0};
+    const double expected_fps{replay_config.throttle ? recorded_fps * replay_config.speed : 0.0};
+    const double replayed_fps{last_capture > first_capture ?
+        (replayed - 1) * 1e6 / (last_capture - first_capture) : 0.0};
+    const double kMinRate{0.8};
+
+    // Report
+    std::cout << "Recording:   " << replay_config.path << " (" << replay->RecordedFrames() << " frames)" << std::endl
+              << "Replay:      " << (replay_config.throttle ? "throttled, speed " : "unthrottled")
+              << (replay_config.throttle ? std::to_string(replay_config.speed) : "") << std::endl
+              << "Camera:      " << frames << " frames (" << frames / elapsed << " fps), "
+              << replay->FramesReplayed() << " recorded frames sent, "
+              << replay->Loops() << " loops" << std::endl
+              << "Rate:        " << replayed_fps << " recorded fps delivered";
+    if (replay_config.throttle) {
+        std::cout << " (recorded at " << recorded_fps << " fps, expected " << expected_fps << " fps)";
+    }
+    std::cout << std::endl
+              << "Check:       " << unexpected << " frames out of order or not recorded" << std::endl;
+    PrintStatistics(cam.statistics());
+
+    if (frames == 0 || unexpected > 0 || replayed_fps < kMinRate * expected_fps) {
+        std::cerr << "Replay check failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Codec benchmark: lossless compression of simulated U16 frames
+ *        (ratio, encode/decode throughput, exact round trip)
+ */
+int BenchmarkCodec(int argc, char** argv) {
+
+    // Simulated sensor settings (unthrottled, no losses)
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    sim_config.throttle = false;
+    const int num_frames{argc > 3 ? atoi(argv[3]) : 20};
+    const int iterations{argc > 4 ? atoi(argv[4]) : 20};
+
+    // Grab the frames
+    auto simulator = std::make_shared<LeptonSimulator>(sim_config);
+    LePi lePi(simulator);
+    if (!lePi.OpenConnection()) {
+        std::cerr << "Unable to open communication with the sensor" << std::endl;
+        return EXIT_FAILURE;
+    }
+    LeptonCameraConfig lp_config(lePi.GetType());
+    const size_t num_pixels{static_cast<size_t>(lp_config.width) * lp_config.height};
+    const size_t raw_size{num_pixels * sizeof(uint16_t)};
+    std::vector<std::vector<uint16_t>> frames(num_frames, std::vector<uint16_t>(num_pixels));
+    for (auto& frame : frames) {
+        lePi.GetFrame(frame.data(), FRAME_U16);
+    }
+    lePi.CloseConnection();
+
+    // Encode
+    std::vector<std::vector<uint8_t>> encoded(num_frames, std::vector<uint8_t>(raw_size));
+    std::vector<size_t> sizes(num_frames, 0);
+    auto tStart = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        for (int i = 0; i < num_frames; ++i) {
+            sizes[i] = CompressFrameU16(frames[i].data(), lp_config.width, lp_config.height,
+                                        encoded[i].data(), raw_size);
+        }
+    }
+    auto tEnd = std::chrono::steady_clock::now();
+    const double encode_us{std::chrono::duration<double, std::micro>(tEnd - tStart).count() /
+                           (iterations * num_frames)};
+
+    // Decode, and check the round trip
+    std::vector<uint16_t> decoded(num_pixels);
+    bool lossless{true};
+    tStart = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        for (int i = 0; i < num_frames; ++i) {
+            lossless = DecompressFrameU16(encoded[i].data(), sizes[i], lp_config.width,
+                                          lp_config.height, decoded.data()) &&
+                       (it > 0 || decoded == frames[i]) && lossless;
+        }
+    }
+    tEnd = std::chrono::steady_clock::now();
+    const double decode_us{std::chrono::duration<double, std::micro>(tEnd - tStart).count() /
+                           (iterations * num_frames)};
+
+    // Random pixels do not compress, and must be reported as such
+    std::mt19937 rng(1);
+    std::vector<uint16_t> noise(num_pixels);
+    for (auto& pixel : noise) {
+        pixel = static_cast<uint16_t>(rng());
+    }
+    const bool noise_rejected{CompressFrameU16(noise.data(), lp_config.width, lp_config.height,
+                                               encoded[0].data(), raw_size) == 0};
+
+    // Malformed frame responses (sizes wrapping around in 32 bits, frame
+    // larger than the message, unknown bpp) must be rejected by the decoder
+    std::unique_ptr<WireMessage> wire(new WireMessage);
+    std::unique_ptr<ResponseMessage> response(new ResponseMessage);
+    auto rejected = [&](uint32_t width, uint32_t height, uint32_t bpp,
+                        FrameEncoding encoding, const uint8_t* payload, uint32_t payload_length) {
+        ResponseHeader header;
+        header.req_type = REQUEST_FRAME;
+        header.req_status = STATUS_FRAME_READY;
+        header.width = width;
+        header.height = height;
+        header.bpp = bpp;
+        header.encoding = encoding;
+        memcpy(EncodeResponseHeader(header, payload_length, *wire), payload, payload_length);
+        return !DecodeResponse(*wire, *response);
+    };
+    const std::vector<uint8_t> zeros(kMaxPayloadSize, 0);
+    std::vector<uint8_t> compressed(raw_size);
+    const size_t compressed_size{CompressFrameU16(frames[0].data(), lp_config.width, lp_config.height,
+                                                  compressed.data(), raw_size)};
+    const bool bad_headers_rejected{
+        compressed_size > 0 &&
+        !rejected(lp_config.width, lp_config.height, 2, ENCODING_LOSSLESS, compressed.data(), compressed_size) &&
+        rejected(46341, 46341, 2, ENCODING_LOSSLESS, compressed.data(), compressed_size) &&
+        rejected(kMaxWidth + 1, kMaxHeight, 2, ENCODING_LOSSLESS, compressed.data(), compressed_size) &&
+        rejected(lp_config.width, lp_config.height, 1, ENCODING_LOSSLESS, compressed.data(), compressed_size) &&
+        rejected(46341, 46341, 2, ENCODING_RAW, zeros.data(), 9266) &&     // 46341^2 * 2 wraps to 9266
+        rejected(kMaxWidth + 1, 1, 1, ENCODING_RAW, zeros.data(), kMaxWidth + 1) &&
+        rejected(1, kMaxHeight + 1, 1, ENCODING_RAW, zeros.data(), kMaxHeight + 1) &&
+        rejected(80, 60, 3, ENCODING_RAW, zeros.data(), 80 * 60 * 3) &&
+        rejected(80, 60, 0, ENCODING_RAW, zeros.data(), 80 * 60)};
+
+    // Report
+    const double mean_size{std::accumulate(sizes.begin(), sizes.end(), 0.0) / num_frames};
+    std::cout << "Sensor:      " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Frames:      " << num_frames << " x " << iterations << std::endl
+              << "Size:        " << raw_size << " -> " << mean_size << " bytes/frame ("
+              << raw_size / mean_size << "x, " << 8.0 * mean_size / num_pixels << " bits/pixel)" << std::endl
+              << "Encode:      " << encode_us << " us/frame (" << raw_size / encode_us << " MB/s)" << std::endl
+              << "Decode:      " << decode_us << " us/frame (" << raw_size / decode_us << " MB/s)" << std::endl
+              << "Lossless:    " << (lossless ? "yes" : "no") << std::endl
+              << "Noise frame: " << (noise_rejected ? "sent uncompressed" : "compressed") << std::endl
+              << "Bad headers: " << (bad_headers_rejected ? "rejected" : "accepted") << std::endl;
+
+    if (!lossless || !noise_rejected || !bad_headers_rejected) {
+        std::cerr << "Codec round trip failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Allocation check: runs the capture and serve loop (frame getters,
+ *        ring subscriber, and the LePiServer MessageServer and FramePublisher
+ *        fan-out, sending leased frames to local clients) and counts the heap
+ *        allocations once warmed up
+ * @return EXIT_FAILURE if the steady state loop allocates
+ */
+int BenchmarkAlloc(int argc, char** argv) {
+
+    // Simulated sensor settings (unthrottled, the grabber runs flat out)
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    sim_config.throttle = false;
+    sim_config.desync_rate = 0.001;
+    const int num_frames{argc > 3 ? atoi(argv[3]) : 200};
+    const int kWarmupFrames{20};
+    const int kPortNumber{5996};
+    const std::chrono::seconds kMaxTime{60};
+
+    // Open camera
+    auto simulator = std::make_shared<LeptonSimulator>(sim_config);
+    LeptonCamera cam(simulator);
+    auto subscriber = cam.subscribe(RING_DROP_OLDEST);
+    cam.start();
+
+    // Server, as run by LePiServer
+    MessageServer server(3, 2);
+    if (!server.Listen(kPortNumber)) {
+        std::cerr << "Unable to create connection." << std::endl;
+        return EXIT_FAILURE;
+    }
+    server.Watch(cam.frameEventFd());
+    FramePublisher publisher(server, cam, std::chrono::milliseconds(500));
+    server.OnRequest([&](int client, const WireMessage& request) {
+        RequestMessage req_msg;
+        if (DecodeRequest(request, req_msg)) {
+            publisher.HandleRequest(client, req_msg);
+        }
+    });
+    server.OnDisconnect([&](int client) {
+        publisher.RemoveClient(client);
+    });
+    uint64_t published{0};
+    server.OnEvent([&](int) {
+        published += publisher.Publish() > 0 ? 1 : 0;
+    });
+
+    // Local clients: U8 subscriber, compressed U16 subscriber with credits,
+    // and U16 requests
+    const RequestType kClientTypes[]{REQUEST_SUBSCRIBE, REQUEST_SUBSCRIBE, REQUEST_FRAME};
+    const RequestCmd kClientCmds[]{CMD_FRAME_U8, CMD_FRAME_U16_COMPRESSED, CMD_FRAME_U16};
+    const uint32_t kClientCredits[]{0, 2, 0};
+    std::atomic<int> connected{0};
+    std::atomic<bool> stop_clients{false};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < 3; ++i) {
+        clients.emplace_back([&, i]() {
+            int socket_handle{-1};
+            if (!ConnectSubscriber(kPortNumber, "127.0.0.1", socket_handle)) {
+                return;
+            }
+            std::unique_ptr<WireMessage> wire(new WireMessage);
+            RequestMessage req_msg;
+            req_msg.req_type = kClientTypes[i];
+            req_msg.req_cmd = kClientCmds[i];
+            req_msg.credits = kClientCredits[i];
+            RequestMessage credit_msg;
+            credit_msg.req_type = REQUEST_CREDIT;
+            credit_msg.credits = 1;
+            ++connected;
+            try {
+                SendMessage(socket_handle, req_msg);
+                while (!stop_clients) {
+                    if (!ReceiveWire(socket_handle, *wire, 100)) {
+                        continue;
+                    }
+                    if (req_msg.req_type == REQUEST_FRAME) {
+                        SendMessage(socket_handle, req_msg);
+                    }
+                    else if (req_msg.credits > 0) {
+                        SendMessage(socket_handle, credit_msg);
+                    }
+                }
+                req_msg.req_type = REQUEST_EXIT;
+                SendMessage(socket_handle, req_msg);
+            }
+            catch (const std::runtime_error&) {
+                // Connection lost
+            }
+            close(socket_handle);
+        });
+    }
+
+    // Serve loop
+    std::vector<uint8_t> imgU8(cam.width() * cam.height());
+    std::vector<uint16_t> imgU16(cam.width() * cam.height());
+    LeptonFrame ring_frame;
+    uint64_t allocations{0};
+    uint64_t frames{0};     // frames published once warmed up
+    bool warm{false};
+    const auto end = std::chrono::steady_clock::now() + kMaxTime;
+    while ((!warm || published - frames < static_cast<uint64_t>(num_frames)) &&
+           std::chrono::steady_clock::now() < end) {
+        if (!warm && published >= static_cast<uint64_t>(kWarmupFrames) && connected == 3) {
+            allocations = heap_allocations;
+            frames = published;
+            warm = true;
+        }
+        if (server.Poll(100) < 0) {
+            break;
+        }
+        publisher.Expire();
+
+        // Frame getters
+        if (cam.hasFrame()) {
+            cam.getFrameU8(imgU8);
+            cam.getFrameU16(imgU16);
+        }
+        subscriber->read(ring_frame, std::chrono::milliseconds(0));
+    }
+    allocations = heap_allocations - allocations;
+    frames = published - frames;
+    const uint64_t dropped{server.Dropped()};
+
+    stop_clients = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    cam.stop();
+
+    // Report
+    const LeptonStatistics stats{cam.statistics()};
+    std::cout << "Sensor:      " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Frames:      " << frames << " published to "
+              << connected << " clients, " << dropped << " responses dropped" << std::endl
+              << "Resyncs:     " << stats.packet_mismatches << " packet, "
+              << stats.segment_mismatches << " segment" << std::endl
+              << "Allocations: " << allocations << std::endl;
+
+    if (!warm || frames < static_cast<uint64_t>(num_frames)) {
+        std::cerr << "Serve loop did not publish all the frames" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (allocations != 0) {
+        std::cerr << "Steady state loop allocates memory" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Resync benchmark: camera resyncs while busy threads load all the
+ *        CPUs, with the default grabber thread settings or with SCHED_FIFO
+ *        priority, CPU pinning and locked buffers
+ */
+int BenchmarkResync(int argc, char** argv) {
+
+    // Simulated sensor settings (real time pacing)
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    const int seconds{argc > 3 ? atoi(argv[3]) : 10};
+    const unsigned int num_cpus{std::max(1u, std::thread::hardware_concurrency())};
+    const int load_threads{argc > 4 ? atoi(argv[4]) : static_cast<int>(2 * num_cpus)};
+    const bool realtime{argc > 5 && std::string(argv[5]) == "rt"};
+    LeptonCaptureOptions options;
+    if (realtime) {
+        options.realtime_priority = 50;
+        options.cpu_affinity = static_cast<int>(num_cpus) - 1;
+        options.lock_memory = true;
+    }
+
+    // Synthetic CPU load
+    std::atomic<bool> run{true};
+    std::vector<std::thread> load;
+    for (int i = 0; i < load_threads; ++i) {
+        load.emplace_back([&run]() {
+            volatile uint64_t value{1};
+            while (run) {
+                for (int j = 0; j < 100000; ++j) {
+                    value = value * 6364136223846793005ull + 1442695040888963407ull;
+                }
+            }
+        });
+    }
+
+    // Stream frames
+    auto simulator = std::make_shared<LeptonSimulator>(sim_config);
+    uint64_t frames_read{0};
+    LeptonStatistics stats;
+    {
+        LeptonCamera cam(simulator, options);
+        cam.start();
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        while (std::chrono::steady_clock::now() < end) {
+            if (cam.waitForFrame(std::chrono::milliseconds(100))) {
+                cam.leaseFrame();
+                ++frames_read;
+            }
+        }
+        cam.stop();
+        stats = cam.statistics();
+    }
+    run = false;
+    for (auto& thread : load) {
+        thread.join();
+    }
+
+    // Report
+    std::cout << "Sensor:       " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Grabber:      " << (realtime ? "SCHED_FIFO 50, pinned, mlock" : "default") << std::endl
+              << "Load threads: " << load_threads << " (" << num_cpus << " CPUs)" << std::endl
+              << "Frames read:  " << frames_read << " (" << frames_read / static_cast<double>(seconds) << " fps)" << std::endl
+              << "Resyncs:      " << stats.packet_mismatches + stats.segment_mismatches << " ("
+              << (stats.packet_mismatches + stats.segment_mismatches) / static_cast<double>(seconds) << " /s)" << std::endl
+              << "SPI resets:   " << simulator->SPIOpenCount() - 1 << std::endl
+              << "Reboots:      " << simulator->RebootCount() << std::endl;
+    PrintStatistics(stats);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Stop benchmark: time to stop the camera while the grabber can't sync
+ *        (every packet lost at desync rate 1), e.g. on a SIGINT to LePiServer
+ */
+int BenchmarkStop(int argc, char** argv) {
+
+    // Simulated sensor settings (real time pacing, lossy)
+    LeptonSimulatorConfig sim_config;
+    sim_config.type = (argc > 2 && std::string(argv[2]) == "lepton2") ? LEPTON2 : LEPTON3;
+    sim_config.desync_rate = argc > 3 ? atof(argv[3]) : 1.0;
+    const int seconds{argc > 4 ? atoi(argv[4]) : 3};
+    const int max_stop_ms{argc > 5 ? atoi(argv[5]) : 3000};
+
+    // Let the grabber resync (and reboot the sensor) for a while, then stop it
+    auto simulator = std::make_shared<LeptonSimulator>(sim_config);
+    LeptonCamera cam(simulator);
+    cam.start();
+    uint64_t frames_read{0};
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        if (cam.waitForFrame(std::chrono::milliseconds(100))) {
+            cam.leaseFrame();
+            ++frames_read;
+        }
+    }
+    const auto stop_start = std::chrono::steady_clock::now();
+    cam.stop();
+    const auto stop_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - stop_start).count();
+
+    // Report
+    std::cout << "Sensor:       " << (sim_config.type == LEPTON2 ? "Lepton 2" : "Lepton 3") << std::endl
+              << "Desync rate:  " << sim_config.desync_rate << std::endl
+              << "Frames read:  " << frames_read << std::endl
+              << "SPI resets:   " << simulator->SPIOpenCount() - 1 << std::endl
+              << "Reboots:      " << simulator->RebootCount() << std::endl
+              << "Stop time:    " << stop_time << " ms (max " << max_stop_ms << " ms)" << std::endl;
+    if (stop_time > max_stop_ms) {
+        std::cerr << "Camera stop took too long" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+#ifdef LEPTON_I2C_DEV
+/**
+ * @brief Fake Lepton CCI (I2C) bus master, plugged in the i2c-dev driver in
+ *        place of the /dev/i2c-<port> system calls. Each bus has one sensor
+ *        at the Lepton address, with the CCI registers, the data block buffer
+ *        and an attribute store the GET/SET/RUN commands read and write.
+ *        Bus 6 is SMBus only, bus 7 can't be opened.
+ */
+struct FakeLepton {
+    uint16_t registers[(LEP_I2C_DATA_CRC_REG >> 1) + 1]{};
+    uint16_t buffer[LEP_I2C_DATA_BUFFER_0_LENGTH >> 1]{};
+    std::map<uint16_t, std::vector<uint16_t>> attributes;
+    int busy_polls{0};
+    uint64_t runs{0};
+};
+
+struct FakeCCIMaster {
+    std::mutex mutex;
+    std::map<int, FakeLepton> sensors;          // By bus fd
+    std::map<int, int> opens;                   // By bus
+    std::map<int, int> closes;                  // By bus
+    uint64_t transfers{0};
+    uint64_t combined_reads{0};
+    std::vector<uint8_t> last_write;            // Bytes of the last register write
+    bool fail_io{false};                        // Transfers fail with EIO
+    std::atomic<int> in_transfer{0};
+    std::atomic<uint64_t> overlaps{0};          // Transfers running concurrently
+};
+FakeCCIMaster fake_cci;
+
+constexpr int kFakeBusFdBase{100};
+constexpr int kFakeSMBusOnlyBus{6};
+constexpr int kFakeMissingBus{7};
+constexpr int kFakeBusyPolls{2};
+
+uint16_t* FakeLeptonWord(FakeLepton& sensor, uint16_t address) {
+    if (address <= LEP_I2C_DATA_CRC_REG) {
+        return &sensor.registers[address >> 1];
+    }
+    if (address >= LEP_I2C_DATA_BUFFER_0 && address <= LEP_I2C_DATA_BUFFER_0_END) {
+        return &sensor.buffer[(address - LEP_I2C_DATA_BUFFER_0) >> 1];
+    }
+    return nullptr;
+}
+
+void FakeLeptonCommand(FakeLepton& sensor, uint16_t command) {
+    const uint16_t length{sensor.registers[LEP_I2C_DATA_LENGTH_REG >> 1]};
+    uint16_t* data{length <= 16 ? &sensor.registers[LEP_I2C_DATA_0_REG >> 1] : sensor.buffer};
+    auto& attribute = sensor.attributes[command & ~0x0003];
+    switch (command & 0x0003) {
+    case LEP_GET_TYPE:
+        attribute.resize(length, 0);
+        std::copy(attribute.begin(), attribute.end(), data);
+        break;
+    case LEP_SET_TYPE:
+        attribute.assign(data, data + length);
+        break;
+    default:
+        ++sensor.runs;
+        break;
+    }
+    sensor.registers[LEP_I2C_DATA_CRC_REG >> 1] = 0;    // No CRC check
+    sensor.busy_polls = kFakeBusyPolls;
+}
+
+int FakeI2COpen(const char* path, int) {
+    int bus{-1};
+    if (std::sscanf(path, "/dev/i2c-%d", &bus) != 1 || bus == kFakeMissingBus) {
+        errno = ENOENT;
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(fake_cci.mutex);
+    ++fake_cci.opens[bus];
+    fake_cci.sensors[kFakeBusFdBase + bus];
+    return kFakeBusFdBase + bus;
+}
+
+int FakeI2CClose(int fd) {
+    std::lock_guard<std::mutex> lock(fake_cci.mutex);
+    ++fake_cci.closes[fd - kFakeBusFdBase];
+    return 0;
+}
+
+int FakeI2CIoctl(int fd, unsigned long request, void* arg) {
+    if (request == I2C_FUNCS) {
+        *static_cast<unsigned long*>(arg) = (fd - kFakeBusFdBase == kFakeSMBusOnlyBus) ?
+                    I2C_FUNC_SMBUS_QUICK : (I2C_FUNC_I2C | I2C_FUNC_SMBUS_QUICK);
+        return 0;
+    }
+    if (request != I2C_RDWR) {
+        errno = ENOTTY;
+        return -1;
+    }
+
+    // Transfers of different cameras must not overlap (LEP_I2C lock)
+    if (++fake_cci.in_transfer > 1) {
+        ++fake_cci.overlaps;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+    --fake_cci.in_transfer;
+
+    std::lock_guard<std::mutex> lock(fake_cci.mutex);
+    const auto* transfer = static_cast<const i2c_rdwr_ioctl_data*>(arg);
+    const i2c_msg* msgs{transfer->msgs};
+    ++fake_cci.transfers;
+    if (fake_cci.fail_io) {
+        errno = EIO;
+        return -1;
+    }
+    for (uint32_t i = 0; i < transfer->nmsgs; ++i) {
+        if (msgs[i].addr != LEP_I2C_DEVICE_ADDRESS) {
+            errno = ENXIO;      // Not acknowledged
+            return -1;
+        }
+    }
+    FakeLepton& sensor = fake_cci.sensors[fd];
+
+    // Register write: big endian address, then big endian words
+    if (transfer->nmsgs == 1 && !(msgs[0].flags & I2C_M_RD) && msgs[0].len >= 2) {
+        fake_cci.last_write.assign(msgs[0].buf, msgs[0].buf + msgs[0].len);
+        uint16_t address = (msgs[0].buf[0] << 8) | msgs[0].buf[1];
+        for (uint16_t i = 2; i + 1 < msgs[0].len; i += 2, address += 2) {
+            const uint16_t value = (msgs[0].buf[i] << 8) | msgs[0].buf[i + 1];
+            uint16_t* word{FakeLeptonWord(sensor, address)};
+            if (word == nullptr) {
+                errno = EIO;
+                return -1;
+            }
+            *word = value;
+            if (address == LEP_I2C_COMMAND_REG) {
+                FakeLeptonCommand(sensor, value);
+            }
+        }
+        return 1;
+    }
+
+    // Register read: address write and data read, in one combined transfer
+    if (transfer->nmsgs == 2 && !(msgs[0].flags & I2C_M_RD) && msgs[0].len == 2 &&
+        (msgs[1].flags & I2C_M_RD)) {
+        ++fake_cci.combined_reads;
+        uint16_t address = (msgs[0].buf[0] << 8) | msgs[0].buf[1];
+        for (uint16_t i = 0; i + 1 < msgs[1].len; i += 2, address += 2) {
+            uint16_t* word{FakeLeptonWord(sensor, address)};
+            if (word == nullptr) {
+                errno = EIO;
+                return -1;
+            }
+            uint16_t value{*word};
+            if (address == LEP_I2C_STATUS_REG) {
+                value = sensor.busy_polls > 0 ? LEP_I2C_STATUS_BUSY_BIT_MASK : 0;
+                sensor.busy_polls = std::max(0, sensor.busy_polls - 1);
+            }
+            msgs[1].buf[i] = value >> 8;
+            msgs[1].buf[i + 1] = value & 0xFF;
+        }
+        return 2;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+const DEV_I2C_BUS_OPS_T kFakeBusOps{FakeI2COpen, FakeI2CIoctl, FakeI2CClose};
+#endif
+
+/**
+ * @brief I2C benchmark: runs the i2c-dev I2C driver and the LEP_I2C
+ *        transactions of two cameras (one thread each) against a fake CCI
+ *        bus master, and checks the transfer framing, the shared bus
+ *        refcount, the error paths and that the cameras' transfers never
+ *        overlap
+ */
+int BenchmarkI2C(int argc, char** argv) {
+#ifdef LEPTON_I2C_DEV
+    const int num_transactions{argc > 2 ? atoi(argv[2]) : 200};
+    DEV_I2C_SetBusOps(&kFakeBusOps);
+    int failures{0};
+    auto check = [&failures](const char* name, bool passed) {
+        std::cout << "  " << name << ": " << (passed ? "ok" : "FAILED") << std::endl;
+        failures += passed ? 0 : 1;
+    };
+    LEP_UINT16 status{0};
+    LEP_UINT16 baud_rate{400};
+
+    // Driver: framing of the register accesses
+    std::cout << "Driver:" << std::endl;
+    check("open bus 1", DEV_I2C_MasterInit(1, &baud_rate) == LEP_OK);
+    check("register write is big endian, one message",
+          DEV_I2C_MasterWriteRegister(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_DATA_1_REG, 0x1234, &status) == LEP_OK &&
+          fake_cci.last_write == std::vector<uint8_t>({0x00, 0x0A, 0x12, 0x34}));
+    LEP_UINT16 value{0};
+    const uint64_t combined_reads{fake_cci.combined_reads};
+    check("register read is one combined transfer",
+          DEV_I2C_MasterReadRegister(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_DATA_1_REG, &value, &status) == LEP_OK &&
+          value == 0x1234 && fake_cci.combined_reads == combined_reads + 1);
+    std::vector<LEP_UINT16> block(LEP_I2C_DATA_BUFFER_0_LENGTH >> 1);
+    std::vector<LEP_UINT16> block_read(block.size() + 1);
+    std::iota(block.begin(), block.end(), 0x0100);
+    LEP_UINT16 words{0};
+    check("data block round trip",
+          DEV_I2C_MasterWriteData(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_DATA_BUFFER_0, block.data(),
+                                  block.size(), &words, &status) == LEP_OK && words == block.size() &&
+          DEV_I2C_MasterReadData(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_DATA_BUFFER_0, block_read.data(),
+                                 block.size(), &words, &status) == LEP_OK && words == block.size() &&
+          std::equal(block.begin(), block.end(), block_read.begin()));
+
+    // Driver: error paths
+    check("block overflow rejected",
+          DEV_I2C_MasterReadData(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_DATA_BUFFER_0, block_read.data(),
+                                 block.size() + 1, &words, &status) == LEP_ERROR_I2C_BUFFER_OVERFLOW &&
+          DEV_I2C_MasterWriteData(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_DATA_BUFFER_0, block_read.data(),
+                                  block.size() + 1, &words, &status) == LEP_ERROR_I2C_BUFFER_OVERFLOW &&
+          words == 0);
+    check("invalid bus rejected", DEV_I2C_MasterInit(16, &baud_rate) == LEP_COMM_INVALID_PORT_ERROR);
+    check("missing bus fails", DEV_I2C_MasterInit(kFakeMissingBus, &baud_rate) == LEP_ERROR);
+    check("SMBus only bus fails, and is closed",
+          DEV_I2C_MasterInit(kFakeSMBusOnlyBus, &baud_rate) == LEP_ERROR &&
+          fake_cci.closes[kFakeSMBusOnlyBus] == 1);
+    check("transfer on a closed bus fails",
+          DEV_I2C_MasterReadRegister(2, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_STATUS_REG, &value, &status) == LEP_ERROR_I2C_FAIL);
+    fake_cci.fail_io = true;
+    check("bus I/O error fails",
+          DEV_I2C_MasterReadRegister(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_STATUS_REG, &value, &status) == LEP_ERROR_I2C_FAIL &&
+          DEV_I2C_MasterWriteRegister(1, LEP_I2C_DEVICE_ADDRESS, LEP_I2C_DATA_1_REG, 0, &status) == LEP_ERROR);
+    fake_cci.fail_io = false;
+
+    // Driver: a bus shared by two ports is opened once, closed by the last port
+    check("shared bus opened once",
+          DEV_I2C_MasterInit(1, &baud_rate) == LEP_OK && fake_cci.opens[1] == 1);
+    DEV_I2C_MasterClose(1);
+    check("shared bus kept open by the other port", fake_cci.closes[1] == 0);
+    DEV_I2C_MasterClose(1);
+    DEV_I2C_MasterClose(1);
+    check("shared bus closed by the last port, once", fake_cci.closes[1] == 1);
+
+    // SDK: two cameras (bus 1 and 3), one thread each, run GET/SET/RUN commands
+    std::cout << "Transactions:" << std::endl;
+    LEP_CAMERA_PORT_DESC_T ports[2];
+    const LEP_UINT16 buses[2]{1, 3};
+    bool opened{true};
+    for (int i = 0; i < 2; ++i) {
+        opened = opened && LEP_OpenPort(buses[i], LEP_CCI_TWI, baud_rate, &ports[i]) == LEP_OK &&
+                 ports[i].deviceAddress == LEP_I2C_DEVICE_ADDRESS;
+        fake_cci.sensors[kFakeBusFdBase + buses[i]].attributes[LEP_CID_SYS_FPA_TEMPERATURE_KELVIN] = {
+            static_cast<uint16_t>(30000 + buses[i])};
+    }
+    check("open ports, sensor found at the Lepton address", opened);
+    std::atomic<uint64_t> failed_transactions{0};
+    std::vector<std::thread> cameras;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2; ++i) {
+        cameras.emplace_back([&, i]() {
+            LEP_CAMERA_PORT_DESC_T& port = ports[i];
+            for (int j = 0; j < num_transactions; ++j) {
+                LEP_SYS_FPA_TEMPERATURE_KELVIN_T temperature{0};
+                LEP_SYS_TELEMETRY_ENABLE_STATE_E state{LEP_TELEMETRY_DISABLED};
+                const auto expected_state = (j % 2) ? LEP_TELEMETRY_ENABLED : LEP_TELEMETRY_DISABLED;
+                if (LEP_GetSysFpaTemperatureKelvin(&port, &temperature) != LEP_OK ||
+                    temperature != 30000 + buses[i] ||
+                    LEP_SetSysTelemetryEnableState(&port, expected_state) != LEP_OK ||
+                    LEP_GetSysTelemetryEnableState(&port, &state) != LEP_OK || state != expected_state ||
+                    LEP_RunSysFFCNormalization(&port) != LEP_OK) {
+                    ++failed_transactions;
+                }
+            }
+        });
+    }
+    for (auto& camera : cameras) {
+        camera.join();
+    }
+    const double elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    check("commands read back each camera's own values", failed_transactions == 0);
+    check("RUN commands reached the sensors",
+          fake_cci.sensors[kFakeBusFdBase + 1].runs == static_cast<uint64_t>(num_transactions) &&
+          fake_cci.sensors[kFakeBusFdBase + 3].runs == static_cast<uint64_t>(num_transactions));
+    check("transfers of different cameras never overlap", fake_cci.overlaps == 0);
+    for (int i = 0; i < 2; ++i) {
+        LEP_ClosePort(&ports[i]);
+    }
+    check("buses closed", fake_cci.closes[1] == 2 && fake_cci.closes[3] == 1);
+    DEV_I2C_SetBusOps(nullptr);
+
+    // Report
+    std::cout << "Transactions: " << 2 * 4 * num_transactions << " (" << 2 * 4 * num_transactions / elapsed
+              << " /s), " << failed_transactions << " failed" << std::endl
+              << "Transfers:    " << fake_cci.transfers << " (" << fake_cci.combined_reads << " combined reads), "
+              << fake_cci.overlaps << " overlapping" << std::endl;
+    if (failures > 0) {
+        std::cerr << failures << " I2C checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+#else
+    (void)argc;
+    (void)argv;
+    std::cerr << "The i2c mode needs the i2c-dev I2C backend (cmake -DLEPTON_I2C_BACKEND=i2c-dev)" << std::endl;
+    return EXIT_FAILURE;
+#endif
+}
+
+/**
+ * @brief Serve benchmark: several clients stream frames (U8 by default) from a running
+ *        LePiServer (e.g. LePiServer simulator_lepton3), the first client
+ *        being slow. Clients request each frame, or subscribe to the pushed
+ *        frames (with credits flow control if credits > 0).
+ */
+int BenchmarkServe(int argc, char** argv) {
+
+    const int num_clients{argc > 2 ? atoi(argv[2]) : 4};
+    const int seconds{argc > 3 ? atoi(argv[3]) : 5};
+    const int slow_delay_ms{argc > 4 ? atoi(argv[4]) : 300};
+    const std::string ip_address{argc > 5 ? argv[5] : ""};
+    const bool push{argc > 6 && std::string(argv[6]) == "push"};
+    const uint32_t credits{argc > 7 ? static_cast<uint32_t>(atoi(argv[7])) : 0u};
+    const std::string format{argc > 8 ? argv[8] : "u8"};
+    const RequestCmd frame_cmd{format == "u16" ? CMD_FRAME_U16 :
+                               format == "compressed" ? CMD_FRAME_U16_COMPRESSED : CMD_FRAME_U8};
+    const int kPortNumber{5995};
+    const int kResponseTimeout{2000};   // ms
+
+    // Client loop: counts frames, missing frames and no frame answers
+    struct Result {
+        bool connected{false};
+        uint64_t frames{0};
+        uint64_t gaps{0};
+        uint64_t no_frame{0};
+        uint64_t timeouts{0};
+        uint64_t bytes{0};
+    };
+    std::vector<Result> results(num_clients);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < num_clients; ++i) {
+        clients.emplace_back([&, i]() {
+            int socket_handle{-1};
+            if (!ConnectSubscriber(kPortNumber, ip_address, socket_handle)) {
+                return;
+            }
+            Result& result = results[i];
+            result.connected = true;
+            RequestMessage req_msg;
+            req_msg.req_type = push ? REQUEST_SUBSCRIBE : REQUEST_FRAME;
+            req_msg.req_cmd = frame_cmd;
+            req_msg.credits = credits;
+            RequestMessage credit_msg;
+            credit_msg.req_type = REQUEST_CREDIT;
+            credit_msg.credits = 1;
+            std::unique_ptr<WireMessage> wire(new WireMessage);
+            std::unique_ptr<ResponseMessage> resp_msg(new ResponseMessage);
+            uint64_t last_id{0};
+            const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+            if (push) {
+                SendMessage(socket_handle, req_msg);
+            }
+            while (std::chrono::steady_clock::now() < end) {
+                if (!push) {
+                    SendMessage(socket_handle, req_msg);
+                }
+                if (!ReceiveWire(socket_handle, *wire, kResponseTimeout)) {
+                    ++result.timeouts;
+                    break;
+                }
+                result.bytes += wire->size;
+                if (!DecodeResponse(*wire, *resp_msg)) {
+                    std::cerr << "Invalid response" << std::endl;
+                    break;
+                }
+                if (resp_msg->req_status != STATUS_FRAME_READY) {
+                    ++result.no_frame;
+                    continue;
+                }
+                if (result.frames > 0 && resp_msg->frame_id != last_id + 1) {
+                    ++result.gaps;
+                }
+                last_id = resp_msg->frame_id;
+                ++result.frames;
+                if (i == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(slow_delay_ms));
+                }
+                if (push && credits > 0) {
+                    SendMessage(socket_handle, credit_msg);
+                }
+            }
+            req_msg.req_type = REQUEST_EXIT;
+            req_msg.req_cmd = CMD_VOID;
+            SendMessage(socket_handle, req_msg);
+            close(socket_handle);
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    // Report
+    bool connected{true};
+    for (int i = 0; i < num_clients; ++i) {
+        const Result& result = results[i];
+        connected = connected && result.connected;
+        std::cout << "Client " << i << (i == 0 ? " (slow): " : ":        ")
+                  << result.frames << " frames (" << result.frames / static_cast<double>(seconds)
+                  << " fps), " << result.gaps << " gaps, " << result.no_frame << " no frame, "
+                  << result.timeouts << " timeouts, "
+                  << (result.frames > 0 ? result.bytes / result.frames : 0) << " bytes/frame"
+                  << std::endl;
+    }
+    if (!connected) {
+        std::cerr << "Unable to connect all the clients" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Benchmark app for the LePi capture path, running on a simulated
+ *        sensor (no Lepton or Raspberry Pi required)
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string benchmark{argv[1]};
+    if (benchmark == "capture") {
+        return BenchmarkCapture(argc, argv);
+    }
+    else if (benchmark == "camera") {
+        return BenchmarkCamera(argc, argv);
+    }
+    else if (benchmark == "ring") {
+        return BenchmarkRing(argc, argv);
+    }
+    else if (benchmark == "unpack") {
+        return BenchmarkUnpack(argc, argv);
+    }
+    else if (benchmark == "group") {
+        return BenchmarkGroup(argc, argv);
+    }
+    else if (benchmark == "record") {
+        return BenchmarkRecord(argc, argv);
+    }
+    else if (benchmark == "replay") {
+        return BenchmarkReplay(argc, argv);
+    }
+    else if (benchmark == "codec") {
+        return BenchmarkCodec(argc, argv);
+    }
+    else if (benchmark == "alloc") {
+        return BenchmarkAlloc(argc, argv);
+    }
+    else if (benchmark == "resync") {
+        return BenchmarkResync(argc, argv);
+    }
+    else if (benchmark == "stop") {
+        return BenchmarkStop(argc, argv);
+    }
+    else if (benchmark == "i2c") {
+        return BenchmarkI2C(argc, argv);
+    }
+    else if (benchmark == "serve") {
+        return BenchmarkServe(argc, argv);
+    }
+
+    PrintUsage();
+    return EXIT_FAILURE;
+}
@@ -64,21 +64,29 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
-    // Prepare frame request message. For simplicity, we chose to ask for
-    // U8 frames, so the image is ready for display. For full pixel depth use U16.
+    // Subscribe to the frame stream, the server pushes each new frame. For
+    // simplicity, we chose to ask for U8 frames, so the image is ready for
+    // display. For full pixel depth use U16.
+    // The server pushes at most kCredits frames ahead of the ones we displayed,
+    // so a slow display does not pile up frames in the network buffers.
+    const uint32_t kCredits{4};
     RequestMessage req_msg;
-    req_msg.req_type = REQUEST_FRAME;
+    req_msg.req_type = REQUEST_SUBSCRIBE;
     req_msg.req_cmd = CMD_FRAME_U8;
+    req_msg.credits = kCredits;
+    SendMessage(socket_handle, req_msg);
+
+    // Each displayed frame gives one credit back
+    RequestMessage credit_msg;
+    credit_msg.req_type = REQUEST_CREDIT;
+    credit_msg.credits = 1;
 
     // Stream data
     cv::Mat ir_img;
     bool force_exit{false};
     while (!force_exit) {
 
-    	//  Send Request
-        SendMessage(socket_handle, req_msg);
-
-        // Receive response
+        // Receive pushed frame
         ResponseMessage resp_msg;
         ReceiveMessage(socket_handle, resp_msg);
 
@@ -88,9 +96,13 @@ int main() {
             case REQUEST_FRAME:
             {
                 DPRINTF("CLIENT -- RECV -- FRAME_REQUEST response. \n");
+                if (resp_msg.req_status != STATUS_FRAME_READY) {
+                    break; // No new frame, keep showing the last one
+                }
                 ir_img = cv::Mat(resp_msg.height, resp_msg.width, CV_8UC1);
                 memcpy(ir_img.data, resp_msg.frame,
                        resp_msg.width * resp_msg.height);
+                SendMessage(socket_handle, credit_msg);
                 break;
             }
             case REQUEST_I2C:
@@ -115,7 +127,9 @@ int main() {
         }
 
         // Show image
-        imshow("IR Img", ir_img);
+        if (!ir_img.empty()) {
+            imshow("IR Img", ir_img);
+        }
         int key = cvWaitKey(5);
         if (key == 27) { // Press ESC to exit
             break;
@@ -123,7 +137,7 @@ int main() {
 
     }
 
-    // Tell server to shutdown
+    // Tell server we leave (it keeps serving the other clients)
     req_msg.req_type = REQUEST_EXIT;
     req_msg.req_cmd = CMD_VOID;
     SendMessage(socket_handle, req_msg);
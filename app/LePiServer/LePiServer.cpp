@@ -25,102 +25,168 @@
  * SOFTWARE.
  */
 
+
 // LePi
 #include <Connection.h>
 #include <ConnectionCommon.h>
+#include <FramePublisher.h>
 #include <LeptonCommon.h>
 #include <LeptonCamera.h>
+#include <LeptonReplay.h>
+#include <LeptonSimulator.h>
+#include <MessageServer.h>
 
 // C/C++
 #include <stdio.h>
-#include <sys/socket.h>
+#include <signal.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Server settings
+constexpr int kPortNumber{5995};
+constexpr size_t kMaxClients{8};
+constexpr size_t kClientQueueSize{2};   // responses queued per client, older frames are dropped
+constexpr int kPollTimeout{100};        // ms
+
+// Max wait time for a new frame (Lepton 3 streams at ~9 fps)
+const std::chrono::milliseconds kFrameTimeout{500};
 
+// Set by SIGINT/SIGTERM
+volatile sig_atomic_t force_exit{0};
+
+void OnExitSignal(int) {
+    force_exit = 1;
+}
 
 /**
- * Sample Server app for streaming video over the local network (TCP)
+ * @brief Encode an I2C command response, with the command result (if any)
  */
-int main() {
+void I2CResponse(WireMessage& msg, bool succeed, uint32_t result) {
+    ResponseHeader header;
+    header.req_type = REQUEST_I2C;
+    header.req_status = succeed ? STATUS_I2C_SUCCEED : STATUS_I2C_FAILED;
+    uint8_t* payload = EncodeResponseHeader(header, succeed ? sizeof(result) : 0, msg);
+    if (succeed) {
+        payload[0] = static_cast<uint8_t>(result >> 24);
+        payload[1] = static_cast<uint8_t>(result >> 16);
+        payload[2] = static_cast<uint8_t>(result >> 8);
+        payload[3] = static_cast<uint8_t>(result);
+    }
+}
+
+
+/**
+ * Sample Server app for streaming video over the local network (TCP).
+ * Serves many clients at once: each frame is captured once, and sent to all
+ * the clients waiting for one. Clients either request each frame, or
+ * subscribe and get each new frame pushed (optionally limited by the credits
+ * they grant, so a slow client is not flooded). U16 frames can be sent
+ * losslessly compressed, for the clients asking for it.
+ * Usage: LePiServer [simulator_lepton2|simulator_lepton3], the optional
+ * argument streams a simulated sensor instead of the one wired to the Pi.
+ *        LePiServer replay <path> [speed|fast], streams a recording (see
+ * LeptonRecorder) at its recorded rate, scaled by speed, or unthrottled.
+ */
+int main(int argc, char** argv) {
+
+    signal(SIGINT, OnExitSignal);
+    signal(SIGTERM, OnExitSignal);
     
-    // Create socket
-    const int kPortNumber{5995};
-    const std::string kIPAddress{""}; // If empty, local IP address is used
-    int socket_connection;
-    if (!ConnectPublisher(kPortNumber, kIPAddress, socket_connection)) {
+    // Create server
+    std::string ipV4{""};
+    std::string ipV6{""};
+    GetIP(ipV4, ipV6);
+    std::cout << "RPi IPv4: " << ipV4 << std::endl;
+    std::cout << "RPi IPv6: " << ipV6 << std::endl;
+    MessageServer server(kMaxClients, kClientQueueSize);
+    if (!server.Listen(kPortNumber)) {
         std::cerr << "Unable to create connection." << std::endl;
         exit(EXIT_FAILURE);
     }
 
     // Open camera connection
-    LeptonCamera lePi;
+    std::shared_ptr<LeptonTransport> transport;
+    const std::string sensor{argc > 1 ? argv[1] : ""};
+    if (sensor == "simulator_lepton2" || sensor == "simulator_lepton3") {
+        LeptonSimulatorConfig sim_config;
+        sim_config.type = sensor == "simulator_lepton2" ? LEPTON2 : LEPTON3;
+        transport = std::make_shared<LeptonSimulator>(sim_config);
+    }
+    else if (sensor == "replay" && argc > 2) {
+        LeptonReplayConfig replay_config;
+        replay_config.path = argv[2];
+        const std::string rate{argc > 3 ? argv[3] : "1"};
+        replay_config.throttle = rate != "fast";
+        replay_config.speed = replay_config.throttle ? atof(rate.c_str()) : 1.0;
+        transport = std::make_shared<LeptonReplay>(replay_config);
+    }
+    LeptonCamera lePi(transport);
     lePi.start();
+    server.Watch(lePi.frameEventFd());
 
-    // Intermediary buffers
-    std::vector<uint8_t> imgU8(lePi.width() * lePi.height());
-    std::vector<uint16_t> imgU16(lePi.width() * lePi.height());
+    // Frames for the clients requesting them, or subscribed
+    FramePublisher publisher(server, lePi, kFrameTimeout);
 
-    bool force_exit{false};
-    while (!force_exit) {
-    
-        //  Receive Request
+    // Client requests
+    server.OnRequest([&](int client, const WireMessage& request) {
         RequestMessage req_msg;
-        ReceiveMessage(socket_connection, req_msg);
-
-        // Frame request msg
-        ResponseMessage resp_msg;
-        switch (req_msg.req_type) {
-
-            case REQUEST_FRAME: {
-                resp_msg.req_type = REQUEST_FRAME;
-                resp_msg.sensor_temperature = lePi.SensorTemperature();
-                if (req_msg.req_cmd == CMD_FRAME_U8) {
-                    lePi.getFrameU8(imgU8);
-                    memcpy(resp_msg.frame, imgU8.data(), imgU8.size());
-                    resp_msg.bpp = 1;
-                } else {
-                    lePi.getFrameU16(imgU16);
-                    memcpy(resp_msg.frame, imgU16.data(), imgU16.size() * 2);
-                    resp_msg.bpp = 2;
-                }
-                resp_msg.req_status = STATUS_FRAME_READY;
-                resp_msg.height = lePi.height();
-                resp_msg.width = lePi.width();
-                break;
-            }
-            case REQUEST_I2C: {
-                resp_msg.req_type = REQUEST_I2C;
-                if (lePi.sendCommand(static_cast<LeptonI2CCmd>(req_msg.req_cmd),
-                                     resp_msg.frame)) {
-                    resp_msg.req_status = STATUS_I2C_SUCCEED;
-                }
-                else {
-                    resp_msg.req_status = STATUS_I2C_FAILED;
-                }
-                break;
-            }
-            case REQUEST_EXIT: {
-                force_exit = true;
-                break;
-            }
-            default : {
-                resp_msg.req_type = REQUEST_UNKNOWN;
-                resp_msg.req_status = STATUS_RESEND;
-                break;
-            }
+        if (!DecodeRequest(request, req_msg)) {
+            req_msg.req_type = REQUEST_UNKNOWN;
+        }
+        if (publisher.HandleRequest(client, req_msg)) {
+            return;
+        }
+        if (req_msg.req_type == REQUEST_EXIT) {
+            // The client leaves, the server keeps serving the others
+            server.Disconnect(client);
+            return;
+        }
+
+        WireMessage* resp_msg = server.NewMessage();
+        if (!resp_msg) {
+            return;
+        }
+        if (req_msg.req_type == REQUEST_I2C) {
+            uint32_t result{0};
+            const bool succeed{lePi.sendCommand(static_cast<LeptonI2CCmd>(req_msg.req_cmd),
+                                                &result)};
+            I2CResponse(*resp_msg, succeed, result);
         }
+        else {
+            EncodeStatusResponse(REQUEST_UNKNOWN, STATUS_RESEND, *resp_msg);
+        }
+        server.Send(client, resp_msg);
+        server.Release(resp_msg);
+    });
+    server.OnDisconnect([&](int client) {
+        publisher.RemoveClient(client);
+    });
+
+    // New frame: fanned out to the waiting clients and to the subscribers
+    server.OnEvent([&](int) {
+        publisher.Publish();
+    });
 
-        // Send response
-        SendMessage(socket_connection, resp_msg);
-   }
+    // Serve the clients
+    while (!force_exit) {
+        if (server.Poll(kPollTimeout) < 0) {
+            std::cerr << "Server poll failed." << std::endl;
+            break;
+        }
+
+        // No frame in time for the waiting clients
+        publisher.Expire();
+    }
 
     // Release sensors
     lePi.stop();
 
-    // Close connection
-    close(socket_connection);
-
     return EXIT_SUCCESS;
 
 }
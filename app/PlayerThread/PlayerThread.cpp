@@ -56,15 +56,15 @@ int main()
     auto start_time = std::chrono::system_clock::now();
     while (true) {
     
-        // Frame request
-        if (cam.hasFrame()) {
+        // Frame request (sleeps until the grabber publishes a new frame)
+        if (cam.waitForFrame(std::chrono::milliseconds(100))) {
             cam.getFrameU8(frame);
             ++frame_nb;
         }
         
         // Display
         cv::imshow("Lepton", img);
-        int key = cv::waitKey(10);
+        int key = cv::waitKey(1);
         if (key == 27) { // Press Esc to exit
             break;
         }
@@ -18,8 +18,12 @@ function (third_party)
 		message(STATUS "OpenCV not found")
 	endif()
 
-	# Load bcm2835
-	find_package(bcm2835 REQUIRED)
+	# Load bcm2835 (only required by the bcm2835 I2C backend)
+	if(LEPTON_I2C_BACKEND STREQUAL "bcm2835")
+		find_package(bcm2835 REQUIRED)
+	else()
+		find_package(bcm2835 QUIET)
+	endif()
 	set(bcm2835_FOUND ${bcm2835_FOUND} CACHE INTERNAL "bcm2835: Library found" FORCE)		
 	if(bcm2835_FOUND)
 		set(PKG_LIBRARIES ${bcm2835_LIBRARIES} ${bcm2835_LIBRARY} ${bcm2835_LIBS})
@@ -29,10 +29,15 @@
 
 // LePi
 #include <LeptonCommon.h>
+#include <LeptonStatistics.h>
+#include <LeptonTransport.h>
 
 // C/C++
 #include <atomic>
+#include <chrono>
 #include <ctime>
+#include <memory>
+#include <mutex>
 #include <stdint.h>
 #include <vector>
 
@@ -46,11 +51,15 @@ public:
 
     /**
      * @brief Lepton interface constructor/destructor
+     * @param transport  Sensor transport (SPI/I2C). If empty, the sensor wired to
+     *                   the Raspberry Pi ports is used
+     * @param options    Capture options (SPI read mode, ...)
      */
-    LePi() = default;
+    explicit LePi(std::shared_ptr<LeptonTransport> transport = nullptr,
+                  const LeptonCaptureOptions& options = LeptonCaptureOptions());
     LePi(LePi const&) = delete;
     LePi& operator =(LePi const&) = delete;
-    virtual ~LePi() = default;
+    virtual ~LePi();
 
     /**
      * @brief Open communication with Lepton sensor (I2C and SPI)
@@ -83,7 +92,8 @@ public:
     bool RebootSensor();
 
     /**
-     * @brief Send I2C command to the sensor
+     * @brief Send I2C command to the sensor (safe to call from a thread other
+     *        than the capture one)
      * @param cmd     I2C known command, see Common.h
      * @param buffer  Data buffer, some I2C commands return data (buffer should
      *                have proper size to fit all the returned data)
@@ -93,12 +103,17 @@ public:
 
     /**
      * @brief Get new frame from sensor
-     * @param frame  Buffer to the frame data, must be allocated with proper size
-     * @param type   Desired frame pixel depth (U8 or U16)
+     * @param frame     Buffer to the frame data, must be allocated with proper size
+     * @param type      Desired frame pixel depth (U8 or U16)
+     * @param metadata  Optional, frame metadata decoded from the telemetry rows
+     *                  (not valid if telemetry is off)
+     * @param run       Optional, the read (resyncs included) stops once it is
+     *                  cleared, e.g. by another thread stopping the capture
      * @return true, if frame was successfully read and frame type requested is
-     *         valid, false otherwise
+     *         valid, false otherwise (or when stopped)
      */
-    bool GetFrame(void *frame, LeptonFrameType type);
+    bool GetFrame(void *frame, LeptonFrameType type, LeptonFrameMetadata* metadata = nullptr,
+                  const std::atomic<bool>* run = nullptr);
 
     /**
      * @brief Get Lepton type from sensor info
@@ -106,18 +121,49 @@ public:
      */
     LeptonType GetType();
 
+    /**
+     * @brief Capture path statistics (safe to call while capturing)
+     * @return Counters and latency histogram since open or last reset
+     */
+    inline LeptonStatistics GetStatistics() const { return counters_.Snapshot(); }
+
+    /**
+     * @brief Clear capture path statistics
+     */
+    inline void ResetStatistics() { counters_.Reset(); }
+
 protected:
     /**
      * @brief Read 1 frame segment over SPI
-     * @return Number of resets during a segment read
+     * @param run  Optional, the sync stops once it is cleared
+     * @return Number of resets during a segment read (max_resets when stopped)
      */
-    int LeptonReadSegment(const int max_resets, uint8_t* data_buffer);
+    int LeptonReadSegment(const int max_resets, uint8_t* data_buffer,
+                          const std::atomic<bool>* run = nullptr);
+
+    /**
+     * @brief Check a batch of received packets (no discard packets, and packet
+     *        numbers in sequence)
+     * @param data_buffer   Segment buffer
+     * @param first_packet  Index of the first packet to check
+     * @param num_packets   Number of packets to check
+     * @return true, if all the packets are valid, false otherwise
+     */
+    bool LeptonCheckPackets(const uint8_t* data_buffer, int first_packet, int num_packets);
 
     /**
      * @brief Read 1 frame over SPI
-     * @return Number of resets during the complete frame read
+     * @param run  Optional, the read stops once it is cleared
+     * @return Number of resets during the complete frame read, -1 if stopped
+     */
+    int LeptonReadFrame(const std::atomic<bool>* run = nullptr);
+
+    /**
+     * @brief Check if the latest received frame repeats the previous one
+     *        (telemetry frame counter, or payload hash)
+     * @return true, if frame is a duplicate, false otherwise
      */
-    int LeptonReadFrame();
+    bool LeptonDuplicateFrame();
 
     /**
      * @brief Tries to re-sync SPI communication with sensor
@@ -138,9 +184,21 @@ protected:
     void LeptonUnpackFrame8 (uint8_t *frame);
 
 private:
+    std::shared_ptr<LeptonTransport> transport_;
+    LeptonCaptureOptions options_;
     LeptonCameraConfig config_;
     std::vector<uint16_t> frame_buffer_;
-    int count_{0};
+    std::vector<uint16_t> unpack_buffer_;
     int spi_port_{0};
-    std::atomic<bool> force_reboot_;
+    bool vsync_{false};
+    std::atomic<bool> force_reboot_{false};
+    std::mutex i2c_lock_;   // serializes the I2C commands (capture and housekeeping threads)
+    uint64_t frame_hash_{0};
+    LeptonTelemetryMode telemetry_{TELEMETRY_OFF};
+    LeptonFrameMetadata metadata_;
+
+    // Statistics
+    LeptonCounters counters_;
+    std::chrono::steady_clock::time_point sync_time_;   // latest segment sync
+    std::chrono::steady_clock::time_point frame_time_;  // latest frame sync
 };
@@ -30,16 +30,76 @@
 // LePi
 #include <LeptonAPI.h>
 #include <LeptonCommon.h>
-
-// Third party
-#include <bcm2835.h>
+#include <LeptonFrameRing.h>
+#include <LeptonTransport.h>
 
 // C/C++
 #include <vector>
 #include <cstdint>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <utility>
+
+/**
+ * @brief Camera frame slot, with the number of leases held on its frame. A
+ *        leased slot is not written by the grabber.
+ */
+struct LeptonFrameSlot {
+    LeptonFrame frame;
+    std::atomic<uint32_t> leases{0};
+};
+
+/**
+ * @brief Read-only lease of a camera frame (see LeptonCamera::leaseFrame).
+ *        Each copy holds one lease, released with release ordering, so all
+ *        the frame reads happen before the camera takes the slot back.
+ *        Leases do not allocate memory, and may outlive the camera.
+ */
+class LeptonFrameLease {
+public:
+    LeptonFrameLease() = default;
+    explicit LeptonFrameLease(const std::shared_ptr<LeptonFrameSlot>& slot)
+            : slot_(slot) {
+        slot_->leases.fetch_add(1, std::memory_order_relaxed);
+    }
+    LeptonFrameLease(const LeptonFrameLease& other)
+            : slot_(other.slot_) {
+        if (slot_) {
+            slot_->leases.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    LeptonFrameLease(LeptonFrameLease&& other) noexcept
+            : slot_(std::move(other.slot_)) {}
+    LeptonFrameLease& operator =(LeptonFrameLease other) noexcept {
+        std::swap(slot_, other.slot_);
+        return *this;
+    }
+    ~LeptonFrameLease() { reset(); }
+
+    /**
+     * @brief Release the lease (the frame must not be read afterwards)
+     */
+    void reset() {
+        if (slot_) {
+            slot_->leases.fetch_sub(1, std::memory_order_release);
+            slot_.reset();
+        }
+    }
+
+    /**
+     * @brief Leased frame accessors
+     */
+    inline const LeptonFrame& operator *() const { return slot_->frame; }
+    inline const LeptonFrame* operator ->() const { return &slot_->frame; }
+    inline explicit operator bool() const { return slot_ != nullptr; }
+
+private:
+    std::shared_ptr<LeptonFrameSlot> slot_;
+};
 
 /**
  * @brief Lepton parallel camera interface based on a grabber thread that
@@ -50,21 +110,26 @@ public:
 
     /**
      * @brief Lepton camera constructor/destructor
+     * @param transport  Sensor transport (SPI/I2C). If empty, the sensor wired to
+     *                   the Raspberry Pi ports is used
+     * @param options    Capture options (SPI read mode, grabber thread
+     *                   scheduling, ...)
      * @throw Runtime error when installed Lepton module is not recognized
      */
-    LeptonCamera();
+    explicit LeptonCamera(std::shared_ptr<LeptonTransport> transport = nullptr,
+                          const LeptonCaptureOptions& options = LeptonCaptureOptions());
     // Delete copy constructor and copy operator
     LeptonCamera(LeptonCamera const&) = delete;
     LeptonCamera& operator =(LeptonCamera const&) = delete;
     virtual ~LeptonCamera();
 
     /**
-     * @brief Start camera grabber thread
+     * @brief Start camera grabber and housekeeping threads
      */
     void start();
     
     /**
-     * @brief Stop camera grabber thread
+     * @brief Stop camera grabber and housekeeping threads
      */
     void stop();
 
@@ -78,14 +143,59 @@ public:
     bool sendCommand(LeptonI2CCmd cmd, void* buffer);
 
     /**
-     * @brief Lepton frame accessors
+     * @brief Lepton frame accessors. The getters return the newest complete
+     *        frame, and never block the grabber thread.
      */
-    inline bool hasFrame() const {return has_frame_; }
+    bool hasFrame() const;
     void getFrameU8(std::vector<uint8_t>& frame);
     void getFrameU16(std::vector<uint16_t>& frame);
-    
+
+    /**
+     * @brief Lease the newest complete frame, without copying it. The frame
+     *        stays valid and unchanged while the lease is held, and its slot
+     *        returns to the camera when the last copy of the lease is released.
+     *        At most frame_leases (capture option) frames can be leased at once,
+     *        after that the newest leased frame is returned. Leasing does not
+     *        allocate memory.
+     * @return Read-only frame (U16 pixels, frame id and capture time)
+     */
+    LeptonFrameLease leaseFrame();
+
+    /**
+     * @brief Wait for a frame the readers did not take yet
+     * @param timeout  Max wait time
+     * @return true, if a new frame is ready, false on timeout or stopped camera
+     */
+    bool waitForFrame(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Event file descriptor (eventfd), readable each time a new frame is
+     *        published. Meant for poll/epoll loops: read its 8 bytes counter to
+     *        clear it, then call the frame getters.
+     */
+    inline int frameEventFd() const { return frame_event_fd_; }
+
+    /**
+     * @brief Subscribe to the frame stream. Each subscriber reads every frame,
+     *        in order, tagged with its frame id and capture time.
+     * @param policy  Policy when the subscriber falls behind by more than the
+     *                ring size: lose the oldest frames, or hold the grabber
+     *                (a RING_BLOCK subscriber that stops reading stalls capture)
+     * @return Subscriber, unsubscribed on destruction
+     */
+    std::shared_ptr<LeptonFrameSubscriber> subscribe(LeptonRingPolicy policy = RING_DROP_OLDEST);
+
+    /**
+     * @brief Capture path statistics (discards, resyncs, reboots, latency
+     *        from frame sync to frame read, ...), safe to call at any time
+     */
+    inline LeptonStatistics statistics() const { return lePi_.GetStatistics(); }
+    inline void resetStatistics() { lePi_.ResetStatistics(); }
+
     /**
-     * @brief Lepton sensor specification accessors
+     * @brief Lepton sensor specification accessors. The sensor temperature is
+     *        the latest housekeeping sample (or telemetry value), in Kelvin
+     *        scaled by 100
      */
     inline double SensorTemperature() const { return sensor_temperature_; }
     inline LeptonType LeptonVersion() const { return lepton_type_; }
@@ -97,20 +207,67 @@ private:
      * @brief Camera grabber (runs in a parallel thread)
      */
     void run();
+
+    /**
+     * @brief Camera housekeeping (runs in a parallel thread): samples the
+     *        sensor temperature over I2C at the housekeeping period, unless
+     *        the telemetry rows already carry it
+     */
+    void housekeeping();
+
+    /**
+     * @brief Apply the grabber thread options (SCHED_FIFO priority, CPU
+     *        affinity) to the calling thread. Failures are reported, and the
+     *        thread keeps its default settings.
+     */
+    void configureGrabber();
+
+    /**
+     * @brief Take the newest published frame as read frame (if any)
+     */
+    void acquireFrame();
     
     // Camera grabber thread
     std::thread grabber_thread_;
     std::atomic<bool> run_thread_;
-    std::mutex lock_;
+    LeptonCaptureOptions options_;
+
+    // IR frame triple buffer. The grabber fills the write slot and publishes it
+    // by swapping it with the middle slot. Readers swap the middle slot with the
+    // read slot when it holds a new frame. The middle slot index and the new
+    // frame flag share one atomic, so the grabber never waits for the readers.
+    // A leased read slot is parked instead, and replaced by a spare slot.
+    // The slots are allocated once, and a parked slot is back in use once its
+    // lease count (acquire load) drops to 0.
+    std::vector<std::shared_ptr<LeptonFrameSlot>> frames_;
+    uint8_t frame_write_;
+    uint8_t frame_read_;
+    std::atomic<uint8_t> frame_middle_;
+    std::mutex read_lock_;  // serializes the readers only
+
+    // Frame leases (guarded by the read lock)
+    std::vector<uint8_t> parked_frames_;
+    std::vector<uint8_t> spare_frames_;
+
+    // New frame notification (waitForFrame and eventfd)
+    std::mutex frame_lock_;
+    std::condition_variable frame_cond_;
+    int frame_event_fd_;
+
+    // IR frame ring, feeds the subscribers
+    std::shared_ptr<LeptonFrameRing> frame_ring_;
+    uint64_t frame_id_;
 
-    // IR frame double buffer
-    std::vector<uint16_t> frame_to_read_;
-    std::vector<uint16_t> frame_to_write_;
-    std::atomic<bool> has_frame_;
+    // Housekeeping thread, keeps the I2C reads off the capture path
+    std::thread housekeeping_thread_;
+    std::chrono::milliseconds housekeeping_period_;
+    std::mutex housekeeping_lock_;
+    std::condition_variable housekeeping_cond_;
     
     // Sensor info
     LePi lePi_;
     LeptonType lepton_type_;
     LeptonCameraConfig lepton_config_;
-    double sensor_temperature_;
+    std::atomic<double> sensor_temperature_;
+    std::atomic<bool> telemetry_temperature_;   // temperature taken from the telemetry
 };
@@ -0,0 +1,118 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+// LePi
+#include <LeptonCamera.h>
+#include <LeptonCommon.h>
+#include <LeptonFrameRing.h>
+
+// C/C++
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+// Default max capture time spread of a frame set: half the period of the
+// unique frames (a new frame every 3 VoSPI frames), in microseconds
+constexpr uint32_t kLeptonGroupMaxSkew{kLeptonFramePeriod * 3 / 2};
+
+
+// Camera group statistics
+struct LeptonGroupStatistics {
+    uint64_t frame_sets{0};                 // Frame sets delivered
+    std::vector<uint64_t> skipped_frames;   // Frames skipped to align each camera
+    std::vector<uint64_t> dropped_frames;   // Frames each camera ring dropped (reader too slow)
+    uint64_t skew_sum{0};                   // Sum of the frame sets capture time spread, in microseconds
+    uint64_t max_skew{0};                   // Largest frame set capture time spread, in microseconds
+};
+
+
+/**
+ * @brief Group of Lepton cameras captured together (e.g. two Lepton 3 on
+ *        SPI0.0 and SPI0.1). Each camera runs its own grabber thread, and the
+ *        group delivers synchronized frame sets: one frame per camera, with
+ *        capture times at most max_skew apart. The sensors free run, so the
+ *        frames are matched by capture time, and the frames that have no
+ *        match in the other cameras are skipped.
+ */
+class LeptonCameraGroup {
+public:
+
+    /**
+     * @brief Lepton camera group constructor/destructor
+     * @param cameras   Cameras (not started yet), each with its own transport
+     * @param max_skew  Max capture time spread of a frame set, in microseconds
+     * @throw Runtime error when no camera is given
+     */
+    explicit LeptonCameraGroup(const std::vector<std::shared_ptr<LeptonCamera>>& cameras,
+                               uint32_t max_skew = kLeptonGroupMaxSkew);
+    // Delete copy constructor and copy operator
+    LeptonCameraGroup(LeptonCameraGroup const&) = delete;
+    LeptonCameraGroup& operator =(LeptonCameraGroup const&) = delete;
+    virtual ~LeptonCameraGroup();
+
+    /**
+     * @brief Start/stop the cameras grabber and housekeeping threads
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Read the next synchronized frame set. The frames read meanwhile
+     *        are kept for the next call on timeout.
+     * @param frames   Output frames, one per camera (in the cameras order)
+     * @param timeout  Max wait time for a frame set
+     * @return true, if a frame set was read, false on timeout or stopped cameras
+     */
+    bool read(std::vector<LeptonFrame>& frames, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Group statistics (frame sets, skipped frames, capture time spread)
+     */
+    LeptonGroupStatistics statistics();
+
+    /**
+     * @brief Group accessors
+     */
+    inline size_t size() const { return cameras_.size(); }
+    inline std::shared_ptr<LeptonCamera> camera(size_t index) const { return cameras_[index]; }
+
+private:
+    std::vector<std::shared_ptr<LeptonCamera>> cameras_;
+    std::vector<std::shared_ptr<LeptonFrameSubscriber>> subscribers_;
+    uint64_t max_skew_;
+
+    // Next frame of each camera, waiting for a match
+    std::vector<LeptonFrame> pending_;
+    std::vector<bool> has_pending_;
+
+    LeptonGroupStatistics statistics_;
+};
@@ -55,9 +55,21 @@ enum LeptonFrameType {
 constexpr uint16_t kMaxResetsPerSegment{500};   // packet resets
 constexpr uint16_t kMaxResetsPerFrame{40};      // segment resets
 constexpr uint16_t kMaxResetsBeforeReboot{2};   // frame resets
+constexpr uint16_t kMaxDuplicateFrames{9};      // repeated frames before one is published anyway
+constexpr uint16_t kVsyncSyncPackets{8};        // packets read after a VSYNC edge, while looking for sync
 constexpr uint32_t kLeptonLoadTime{200000};     // 0.2 s = 200 ms = 200000 us
 constexpr uint32_t kLeptonResetTime{300000};    // 0.3 s = 300 ms = 300000 us
 constexpr uint32_t kLeptonRebootTime{1500000};  // 1.5 s = 1500 ms = 1500000 us
+constexpr uint32_t kLeptonFramePeriod{37037};   // 27 Hz = 37.037 ms = 37037 us (VoSPI frame rate)
+constexpr uint32_t kLeptonVsyncTimeout{74074};  // 2 VoSPI frame periods, max wait for a VSYNC edge
+
+
+// Telemetry rows, sent before (header) or after (footer) the image rows
+enum LeptonTelemetryMode {
+    TELEMETRY_OFF,
+    TELEMETRY_HEADER,
+    TELEMETRY_FOOTER
+};
 
 
 // Lepton camera specification, based on the lepton version/type
@@ -77,12 +89,25 @@ struct LeptonCameraConfig {
     uint16_t width;         // Frame width
     uint16_t height;        // Frame height
 
+    uint16_t image_packets;             // image packets per frame
+    uint16_t image_packet_index;        // index of the first image packet in the frame
+    uint16_t telemetry_packet_index;    // index of the first telemetry packet in the frame
+    uint16_t telemetry_packets;         // telemetry packets per frame (0 if telemetry is off)
+
     LeptonCameraConfig() = default;
-    LeptonCameraConfig(LeptonType lp_t) {
+    LeptonCameraConfig(LeptonType lp_t, LeptonTelemetryMode telemetry = TELEMETRY_OFF) {
         packet_size = 164;
         packet_size_uint16 = packet_size / 2;
         packets_per_segment = 60;
-        packets_per_read = 1;   // must be a divisor of packets_per_segment
+        packets_per_read = 1;
+
+        // Telemetry adds 3 rows to a Lepton 2 frame, and 1 packet to each
+        // Lepton 3 segment
+        telemetry_packets = 0;
+        if (telemetry != TELEMETRY_OFF) {
+            packets_per_segment = lp_t == LEPTON2 ? 63 : 61;
+            telemetry_packets = lp_t == LEPTON2 ? 3 : 4;
+        }
 
         segment_size = packet_size * packets_per_segment;
         segment_size_uint16 = packet_size_uint16 * packets_per_segment;
@@ -107,10 +132,62 @@ struct LeptonCameraConfig {
             std::cerr << "Error: Unknown Lepton version.";
             throw std::runtime_error("Unknown Lepton version.");
         }
+
+        // Image and telemetry packets location in the frame
+        image_packets = width * height * 2 / (packet_size - 4);
+        image_packet_index = telemetry == TELEMETRY_HEADER ? telemetry_packets : 0;
+        telemetry_packet_index = telemetry == TELEMETRY_HEADER ? 0 : image_packets;
     };
 };
 
 
+// FFC state, reported by the telemetry
+enum LeptonFFCState {
+    FFC_NEVER_COMMANDED,
+    FFC_IMMINENT,
+    FFC_IN_PROGRESS,
+    FFC_COMPLETE
+};
+
+
+// Frame metadata, decoded from the telemetry rows
+struct LeptonFrameMetadata {
+    bool valid{false};                      // Telemetry available for this frame
+    uint32_t frame_counter{0};              // Sensor frame counter (27 Hz)
+    uint32_t time_counter{0};               // Time since sensor boot, in ms
+    uint16_t fpa_temperature{0};            // FPA temperature in Kelvin, scaled by 100
+    uint16_t housing_temperature{0};        // Housing temperature in Kelvin, scaled by 100
+    LeptonFFCState ffc_state{FFC_NEVER_COMMANDED};
+    bool ffc_desired{false};                // Sensor asks for a FFC
+};
+
+
+// SPI read strategies
+enum LeptonReadMode {
+    READ_PACKET,    // One SPI read per packet, validated as it arrives
+    READ_BULK       // One SPI transfer per segment (or batch of packets), validated afterwards
+};
+
+
+// Lepton capture options, selected by the user when the sensor is opened
+struct LeptonCaptureOptions {
+    int spi_port{0};                        // SPI0 chip select the sensor is wired to (0 -> /dev/spidev0.0, 1 -> /dev/spidev0.1)
+    uint16_t i2c_port{1};                   // I2C bus the sensor is wired to
+    LeptonReadMode read_mode{READ_PACKET};  // SPI read strategy
+    uint16_t frame_ring_size{8};            // Frames kept for the LeptonCamera subscribers
+    uint16_t frame_leases{4};               // Frames that can be leased at once from LeptonCamera
+    bool drop_duplicates{true};             // Skip repeated frames (Lepton 2 sends each frame ~3 times)
+    bool vsync{false};                      // Wait for the sensor VSYNC output before reading a segment
+    unsigned int vsync_gpio{17};            // Raspberry Pi GPIO wired to the Lepton GPIO3 (VSYNC) pin
+    int vsync_phase_delay{0};               // VSYNC phase delay in lines, [-3, 3]
+    LeptonTelemetryMode telemetry{TELEMETRY_OFF};   // Telemetry rows, decoded into the frame metadata
+    uint32_t housekeeping_period{1000};     // LeptonCamera sensor temperature sampling period in ms (0 = off)
+    int realtime_priority{0};               // SCHED_FIFO priority of the LeptonCamera grabber thread, [1, 99] (0 = default scheduling)
+    int cpu_affinity{-1};                   // CPU the LeptonCamera grabber thread is pinned to (-1 = any CPU)
+    bool lock_memory{false};                // Lock the capture buffers in memory (mlock), no page faults while capturing
+};
+
+
 // Lepton I2C commands
 enum LeptonI2CCmd {
     RESET,          // Sensor connection reset
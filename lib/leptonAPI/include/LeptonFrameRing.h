@@ -0,0 +1,168 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// LePi
+#include <LeptonCommon.h>
+
+// C/C++
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+// Subscriber policy, when it falls behind the grabber by more than the ring size
+enum LeptonRingPolicy {
+    RING_DROP_OLDEST,   // Oldest unread frames are overwritten (subscriber loses frames)
+    RING_BLOCK          // Grabber waits for the subscriber (subscriber sees every frame)
+};
+
+
+// IR frame, tagged with its capture info
+struct LeptonFrame {
+    uint64_t frame_id{0};           // Monotonic frame id
+    uint64_t timestamp{0};          // Capture time in microseconds (steady clock)
+    LeptonFrameMetadata metadata;   // Sensor telemetry (valid if telemetry is on)
+    double sensor_temperature{0.0}; // Latest sensor temperature in Kelvin, scaled by 100
+    std::vector<uint16_t> pixels;   // U16 frame
+};
+
+
+// Per subscriber cursor in the frame ring
+struct LeptonRingCursor {
+    LeptonRingPolicy policy;
+    uint64_t next;      // Next ring sequence number to read
+    uint64_t dropped;   // Frames lost due to RING_DROP_OLDEST
+};
+
+
+/**
+ * @brief Bounded ring of the last N frames, shared by several subscribers.
+ *        Each subscriber reads the frames in order through its own cursor.
+ */
+class LeptonFrameRing {
+public:
+    /**
+     * @brief Frame ring constructor
+     * @param capacity    Number of frames kept in the ring
+     * @param frame_size  Number of pixels per frame
+     */
+    LeptonFrameRing(size_t capacity, size_t frame_size);
+    LeptonFrameRing(LeptonFrameRing const&) = delete;
+    LeptonFrameRing& operator =(LeptonFrameRing const&) = delete;
+    virtual ~LeptonFrameRing();
+
+    /**
+     * @brief Add a frame to the ring. Waits for RING_BLOCK subscribers that
+     *        did not read the oldest frame yet.
+     * @param frame  Frame (pixels, id, capture time and metadata), copied
+     * @return true, if frame was added, false if the ring was closed meanwhile
+     */
+    bool push(const LeptonFrame& frame);
+
+    /**
+     * @brief Add/remove a subscriber cursor. New subscribers start with the
+     *        next pushed frame.
+     */
+    std::list<LeptonRingCursor>::iterator addCursor(LeptonRingPolicy policy);
+    void removeCursor(std::list<LeptonRingCursor>::iterator cursor);
+
+    /**
+     * @brief Read the next frame of a subscriber
+     * @param cursor   Subscriber cursor
+     * @param frame    Output frame
+     * @param timeout  Max wait time for a new frame
+     * @return true, if a frame was read, false on timeout or closed ring
+     */
+    bool read(std::list<LeptonRingCursor>::iterator cursor,
+              LeptonFrame& frame,
+              std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Number of frames a subscriber lost
+     */
+    uint64_t dropped(std::list<LeptonRingCursor>::iterator cursor);
+
+    /**
+     * @brief Open/close the ring. Closing wakes up the grabber and the
+     *        subscribers waiting on the ring.
+     */
+    void open();
+    void close();
+
+    /**
+     * @brief Lock the ring frames in memory (mlock), so pushing a frame never
+     *        page faults
+     * @return true, if all the frames were locked, false otherwise
+     */
+    bool lockMemory();
+
+private:
+    std::mutex lock_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::vector<LeptonFrame> slots_;
+    std::list<LeptonRingCursor> cursors_;
+    uint64_t head_{0};      // Next ring sequence number to write
+    bool closed_{false};
+    bool locked_{false};    // Frames locked in memory
+};
+
+
+/**
+ * @brief Frame stream subscriber. Reads every frame from the camera ring,
+ *        following its policy when it falls behind.
+ */
+class LeptonFrameSubscriber {
+public:
+    LeptonFrameSubscriber(std::shared_ptr<LeptonFrameRing> ring, LeptonRingPolicy policy);
+    LeptonFrameSubscriber(LeptonFrameSubscriber const&) = delete;
+    LeptonFrameSubscriber& operator =(LeptonFrameSubscriber const&) = delete;
+    virtual ~LeptonFrameSubscriber();
+
+    /**
+     * @brief Read the next frame
+     * @param frame    Output frame
+     * @param timeout  Max wait time for a new frame
+     * @return true, if a frame was read, false on timeout or stopped camera
+     */
+    bool read(LeptonFrame& frame, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Number of frames lost by this subscriber (RING_DROP_OLDEST)
+     */
+    uint64_t dropped();
+
+private:
+    std::shared_ptr<LeptonFrameRing> ring_;
+    std::list<LeptonRingCursor>::iterator cursor_;
+};
@@ -0,0 +1,267 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+// LePi
+#include <LeptonCamera.h>
+#include <LeptonCommon.h>
+#include <LeptonFrameRing.h>
+
+// C/C++
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+
+// Recording segment file (host byte order, checked by the reader):
+//   header (kRecordHeaderSize bytes) | index (capacity entries) | frames (capacity slots)
+// Frame slot i holds the frame id first_frame_id + i, so a frame is found by
+// its id in O(1). The slots of the frames the recorder lost stay empty.
+constexpr char kRecordMagic[8]{'L', 'E', 'P', 'I', 'R', 'E', 'C', '\0'};
+constexpr uint32_t kRecordVersion{1};
+constexpr uint32_t kRecordByteOrder{0x01020304};
+constexpr uint64_t kRecordHeaderSize{4096};
+constexpr const char* kRecordExtension{".lepi"};
+
+// Index entry flags
+constexpr uint8_t kRecordValid{0x01};       // Slot holds a frame
+constexpr uint8_t kRecordTelemetry{0x02};   // Telemetry fields are valid
+constexpr uint8_t kRecordFFCDesired{0x04};  // Sensor asked for a FFC
+
+// Segment header
+struct LeptonRecordHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t width;
+    uint32_t height;
+    uint32_t capacity;          // Frame slots
+    uint32_t segment;           // Segment number in the recording
+    uint64_t index_offset;      // Index offset in the file, in bytes
+    uint64_t data_offset;       // First frame slot offset in the file, in bytes
+    uint64_t frame_size;        // Frame slot size in bytes (U16 pixels)
+    uint64_t first_frame_id;    // Frame id of the first slot
+    uint64_t count;             // Slots in use, updated after each frame is written
+};
+
+// Index entry, one per frame slot
+struct LeptonRecordEntry {
+    uint64_t frame_id;
+    uint64_t timestamp;             // Capture time in microseconds (steady clock)
+    double sensor_temperature;      // Kelvin, scaled by 100
+    uint32_t frame_counter;         // Telemetry
+    uint32_t time_counter;
+    uint16_t fpa_temperature;
+    uint16_t housing_temperature;
+    uint8_t ffc_state;
+    uint8_t flags;                  // kRecordValid, kRecordTelemetry, kRecordFFCDesired
+    uint8_t reserved[10];
+};
+static_assert(sizeof(LeptonRecordEntry) == 48, "Unexpected record index entry size");
+
+
+// Recorder options
+struct LeptonRecorderOptions {
+    std::string path{"lepton"};     // Segment files: <path>_0000.lepi, <path>_0001.lepi, ...
+    uint32_t segment_frames{4096};  // Frame slots per segment file (preallocated)
+    uint32_t writeback_frames{16};  // Start the writeback every N frames, so the dirty
+                                    // pages go out at the frame rate (0 = kernel decides)
+};
+
+/**
+ * @brief Recording segment file path
+ * @param path     Recording path, see LeptonRecorderOptions
+ * @param segment  Segment number
+ */
+std::string LeptonRecordSegmentPath(const std::string& path, uint32_t segment);
+
+// Recorder statistics
+struct LeptonRecorderStatistics {
+    uint64_t frames{0};         // Frames written
+    uint64_t dropped{0};        // Frames the recorder lost (storage too slow)
+    uint64_t segments{0};       // Segment files created
+    uint64_t bytes{0};          // Frame bytes written
+    bool failed{false};         // Recording stopped on a storage error
+};
+
+
+/**
+ * @brief Records the LeptonCamera frames (U16 pixels and metadata) to
+ *        preallocated, memory-mapped segment files with a frame index. The
+ *        recorder reads the camera ring from its own thread, as a
+ *        RING_DROP_OLDEST subscriber, so slow storage never blocks the
+ *        grabber: the recorder loses frames instead (see statistics).
+ */
+class LeptonRecorder {
+public:
+
+    /**
+     * @brief Lepton recorder constructor/destructor
+     * @param camera   Recorded camera (outlives the recorder)
+     * @param options  Segment files path, size and writeback
+     */
+    explicit LeptonRecorder(LeptonCamera& camera,
+                            const LeptonRecorderOptions& options = LeptonRecorderOptions());
+    // Delete copy constructor and copy operator
+    LeptonRecorder(LeptonRecorder const&) = delete;
+    LeptonRecorder& operator =(LeptonRecorder const&) = delete;
+    virtual ~LeptonRecorder();
+
+    /**
+     * @brief Start recording the new frames, in a new set of segment files
+     */
+    void start();
+
+    /**
+     * @brief Stop recording, the last segment file is trimmed to its frames
+     */
+    void stop();
+
+    /**
+     * @brief Recorder statistics, safe to call at any time
+     */
+    LeptonRecorderStatistics statistics() const;
+
+    /**
+     * @brief Segment file path
+     * @param segment  Segment number
+     */
+    std::string segmentPath(uint32_t segment) const;
+
+private:
+    /**
+     * @brief Recorder (runs in a parallel thread)
+     */
+    void run();
+
+    /**
+     * @brief Create/close a segment file
+     */
+    bool openSegment(uint64_t first_frame_id);
+    void closeSegment();
+
+    /**
+     * @brief Write a frame to the current segment
+     */
+    void writeFrame(const LeptonFrame& frame, uint64_t slot);
+
+    LeptonCamera& camera_;
+    LeptonRecorderOptions options_;
+    std::shared_ptr<LeptonFrameSubscriber> subscriber_;
+
+    // Recorder thread
+    std::thread recorder_thread_;
+    std::atomic<bool> run_thread_;
+
+    // Current segment
+    int segment_fd_;
+    uint8_t* segment_;
+    size_t segment_size_;
+    uint32_t segment_number_;
+    LeptonRecordHeader* header_;
+    LeptonRecordEntry* index_;
+    uint64_t written_back_;     // Slots handed to the writeback
+
+    // Statistics
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> segments_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<bool> failed_;
+};
+
+
+/**
+ * @brief Reads a recording segment file, memory-mapped (read only). Frames
+ *        are accessed in place, by slot, frame id or capture time. A segment
+ *        still being recorded can be read: the frames appear as written.
+ */
+class LeptonRecordReader {
+public:
+
+    /**
+     * @brief Lepton record reader constructor/destructor
+     * @param path  Segment file path
+     * @throw Runtime error if the file can't be mapped, or is not a recording
+     *        segment of this version and byte order
+     */
+    explicit LeptonRecordReader(const std::string& path);
+    // Delete copy constructor and copy operator
+    LeptonRecordReader(LeptonRecordReader const&) = delete;
+    LeptonRecordReader& operator =(LeptonRecordReader const&) = delete;
+    virtual ~LeptonRecordReader();
+
+    /**
+     * @brief Number of frame slots written (some may be empty, see entry flags)
+     */
+    size_t size() const;
+
+    /**
+     * @brief Frame slot index entry and pixels (valid while the reader lives)
+     * @param slot  Frame slot, < size()
+     */
+    inline const LeptonRecordEntry& entry(size_t slot) const { return index_[slot]; }
+    const uint16_t* pixels(size_t slot) const;
+
+    /**
+     * @brief Copy a frame slot to a frame
+     * @return true, if the slot holds a frame, false otherwise
+     */
+    bool read(size_t slot, LeptonFrame& frame) const;
+
+    /**
+     * @brief Find a frame by id, in O(1)
+     * @return Frame slot, -1 if the frame is not in the segment
+     */
+    int64_t findFrameId(uint64_t frame_id) const;
+
+    /**
+     * @brief Find the first frame captured at or after a time. The slot is
+     *        interpolated from the first and last capture times, then
+     *        adjusted: O(1) at a steady frame rate.
+     * @param timestamp  Capture time in microseconds (steady clock)
+     * @return Frame slot, -1 if all the frames were captured before
+     */
+    int64_t findTimestamp(uint64_t timestamp) const;
+
+    /**
+     * @brief Segment accessors
+     */
+    inline const LeptonRecordHeader& header() const { return *header_; }
+    inline uint32_t width() const { return header_->width; }
+    inline uint32_t height() const { return header_->height; }
+
+private:
+    int fd_;
+    const uint8_t* data_;
+    size_t data_size_;
+    const LeptonRecordHeader* header_;
+    const LeptonRecordEntry* index_;
+};
@@ -0,0 +1,132 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+// LePi
+#include <LeptonCommon.h>
+#include <LeptonRecorder.h>
+#include <LeptonSimulator.h>
+
+// C/C++
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Replay settings
+struct LeptonReplayConfig {
+    std::string path{"lepton"};     // Recording path, see LeptonRecorderOptions
+    bool throttle{true};            // Replay at the recorded timing, or as fast as possible
+    double speed{1.0};              // Recorded timing scale, when throttled (2.0 replays twice as fast)
+    bool loop{true};                // Start over at the end of the recording
+};
+
+
+/**
+ * @brief Replays a recording (see LeptonRecorder) as a simulated sensor: the
+ *        recorded frames are sent over the simulated VoSPI stream, so a
+ *        LeptonCamera (and anything built on it) runs the whole capture path
+ *        on them, with no sensor.
+ *
+ *        When throttled, each frame is sent at its recorded capture time
+ *        (scaled by the speed setting): the frames the recorder lost stay lost,
+ *        and the sensor repeats the previous frame meanwhile. When unthrottled,
+ *        every recorded frame is sent once, in order, as fast as the reader
+ *        takes them, so the frames read are the same on every run.
+ */
+class LeptonReplay : public LeptonSimulator {
+public:
+    /**
+     * @brief Lepton replay constructor
+     * @param config  Recording path and replay rate
+     * @throw Runtime error if the recording can't be read
+     */
+    explicit LeptonReplay(const LeptonReplayConfig& config);
+    LeptonReplay(LeptonReplay const&) = delete;
+    LeptonReplay& operator =(LeptonReplay const&) = delete;
+    virtual ~LeptonReplay() = default;
+
+    /**
+     * @brief Sensor temperature recorded with the current frame
+     */
+    unsigned int InternalTemp() override;
+
+    /**
+     * @brief Replay statistics
+     */
+    inline uint64_t FramesReplayed() const { return frames_replayed_; }  // recorded frames sent
+    inline uint64_t Loops() const { return loops_; }
+    inline bool Finished() const { return finished_; }
+
+    /**
+     * @brief Number of frames in the recording
+     */
+    inline uint64_t RecordedFrames() const { return recorded_frames_; }
+
+protected:
+    void RenderScene(uint64_t frame_number, uint16_t* scene) override;
+
+private:
+    /**
+     * @brief Simulated sensor settings matching the recording
+     */
+    static LeptonSimulatorConfig SimulatorConfig(const LeptonReplayConfig& config);
+
+    /**
+     * @brief Position of the recorded frame following a position
+     * @return false, at the end of the recording
+     */
+    bool NextFrame(size_t& segment, size_t& slot) const;
+
+    /**
+     * @brief Capture time of a recorded frame, from the recording start (us)
+     */
+    uint64_t FrameTime(size_t segment, size_t slot) const;
+
+    LeptonReplayConfig config_;
+
+    // Recording segments, and current frame
+    std::vector<std::unique_ptr<LeptonRecordReader>> segments_;
+    size_t segment_{0};
+    size_t slot_{0};
+    uint64_t first_timestamp_{0};
+    uint64_t recorded_frames_{0};
+
+    // Sensor timeline of the current loop
+    uint64_t loop_start_{0};
+    bool started_{false};
+
+    // Replay state
+    std::atomic<unsigned int> temperature_{0};
+    std::atomic<uint64_t> frames_replayed_{0};
+    std::atomic<uint64_t> loops_{0};
+    std::atomic<bool> finished_{false};
+};
@@ -0,0 +1,193 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// LePi
+#include <LeptonCommon.h>
+#include <LeptonTransport.h>
+
+// C/C++
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+// Simulated Lepton sensor settings
+struct LeptonSimulatorConfig {
+    LeptonType type{LEPTON3};           // Simulated Lepton version
+    bool throttle{true};                // Pace reads at the SPI bus and VoSPI frame rate, or run unthrottled
+    double speed{1.0};                  // Sensor timeline speed when throttled (2.0 runs twice the real rate)
+    double desync_rate{0.0};            // Probability of losing a data packet (desync injection)
+    uint32_t seed{1};                   // Random generator seed, used by the desync injection
+    unsigned int temperature{30000};    // Sensor temperature in Kelvin, scaled by 100
+    uint32_t i2c_time{0};               // I2C command duration in microseconds (throttled only)
+};
+
+
+/**
+ * @brief Simulated Lepton 2/3 sensor. Produces a VoSPI stream (discard packets,
+ *        packet and segment numbers, CRC) of a synthetic thermal scene, so the
+ *        capture path can be run and benchmarked without the hardware.
+ *
+ *        The sensor timeline is split in VoSPI frame periods (27 Hz). At the
+ *        beginning of each period a new frame is made available, unread packets
+ *        from the previous period are lost, and discard packets are sent once
+ *        the frame was clocked out. Lepton 2 repeats every frame 3 times, while
+ *        Lepton 3 marks 2 out of 3 frames as invalid (segment number 0).
+ *        When telemetry is on, the telemetry rows are sent before or after
+ *        the image rows.
+ *
+ *        The simulated VSYNC output pulses at the beginning of each segment
+ *        (Lepton 3) or frame (Lepton 2) on the sensor timeline.
+ *
+ *        When throttled, the timeline follows the wall clock (scaled by the
+ *        speed setting) and the reads take as long as on the real SPI bus: a
+ *        read starts when the previous one ended on the bus, and the reader
+ *        only sleeps once it is ahead of the wall clock by more than a few
+ *        packets (a sleep per packet would cost more than the packet time at
+ *        high speeds).
+ *        When unthrottled, the timeline is a virtual clock driven by the reads
+ *        and waits, so no time is spent idle.
+ *
+ *        Derived transports can stream other frames over the same VoSPI
+ *        stream, by rendering their own scene (see LeptonReplay).
+ */
+class LeptonSimulator : public LeptonTransport {
+public:
+    explicit LeptonSimulator(const LeptonSimulatorConfig& config = LeptonSimulatorConfig());
+    LeptonSimulator(LeptonSimulator const&) = delete;
+    LeptonSimulator& operator =(LeptonSimulator const&) = delete;
+    virtual ~LeptonSimulator() = default;
+
+    void OpenSPI(int spi_port, uint32_t spi_speed) override;
+    void CloseSPI(int spi_port) override;
+    void ReadSPI(uint8_t* buffer, size_t size) override;
+
+    void ConnectI2C() override;
+    void DisconnectI2C() override;
+    bool ShutterOpen() override;
+    bool ShutterClose() override;
+    bool FFC() override;
+    bool Reboot() override;
+    unsigned int InternalTemp() override;
+    unsigned int SensorNumber() override;
+
+    bool EnableVsync(unsigned int gpio, int phase_delay) override;
+    void DisableVsync() override;
+    bool WaitVsync(uint32_t timeout) override;
+
+    bool SetTelemetry(LeptonTelemetryMode mode) override;
+
+    void Wait(uint32_t microseconds) override;
+
+    /**
+     * @brief Simulator statistics
+     */
+    inline uint64_t PacketsRead() const { return packets_read_; }
+    inline uint64_t SPITransfers() const { return spi_transfers_; }
+    inline uint64_t DiscardPackets() const { return discard_packets_; }
+    inline uint64_t DesyncsInjected() const { return desyncs_injected_; }
+    inline uint64_t SPIOpenCount() const { return spi_open_count_; }
+    inline uint64_t RebootCount() const { return reboot_count_; }
+    inline uint64_t VsyncEdges() const { return vsync_edges_; }
+
+protected:
+    /**
+     * @brief Generate the thermal scene of a unique frame (synthetic scene by
+     *        default). Called from the reading thread, once per unique frame.
+     * @param frame_number  Unique frame number on the sensor timeline
+     * @param scene         Frame pixels to fill (width x height)
+     */
+    virtual void RenderScene(uint64_t frame_number, uint16_t* scene);
+
+    /**
+     * @brief Simulated sensor settings
+     */
+    inline const LeptonSimulatorConfig& Config() const { return config_; }
+
+private:
+    /**
+     * @brief Current time on the sensor timeline, in nanoseconds
+     */
+    uint64_t Now() const;
+
+    /**
+     * @brief Sleep until a time on the sensor timeline (throttled only)
+     */
+    void SleepUntil(uint64_t time_ns) const;
+
+    /**
+     * @brief Move the sensor timeline to the VoSPI frame period containing time_ns
+     */
+    void UpdatePeriod(uint64_t time_ns);
+
+    /**
+     * @brief Write the next VoSPI packet (data or discard) to the buffer
+     */
+    void WritePacket(uint8_t* packet);
+
+    /**
+     * @brief Write the payload of a telemetry packet (row A carries the frame
+     *        counters, temperatures and FFC state, the other rows are zeroed)
+     */
+    void WriteTelemetry(uint8_t* payload, uint32_t telemetry_packet);
+
+    // Simulator settings
+    LeptonSimulatorConfig config_;
+    LeptonCameraConfig camera_config_;
+
+    // Sensor timeline
+    std::chrono::steady_clock::time_point epoch_;
+    uint64_t clock_ns_{0};
+    uint64_t packet_time_ns_{0};
+    uint64_t bus_time_ns_{0};       // end of the last SPI transfer (throttled)
+    uint64_t period_{UINT64_MAX};   // the first read renders the first frame
+    uint32_t packet_index_{0};
+
+    // Thermal scene
+    std::vector<uint16_t> scene_;
+    uint64_t scene_frame_{UINT64_MAX};
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+
+    // Sensor state
+    std::atomic<bool> spi_open_{false};
+    std::atomic<bool> i2c_open_{false};
+    std::atomic<bool> vsync_{false};
+
+    // Statistics
+    std::atomic<uint64_t> packets_read_{0};
+    std::atomic<uint64_t> spi_transfers_{0};
+    std::atomic<uint64_t> discard_packets_{0};
+    std::atomic<uint64_t> desyncs_injected_{0};
+    std::atomic<uint64_t> spi_open_count_{0};
+    std::atomic<uint64_t> reboot_count_{0};
+    std::atomic<uint64_t> vsync_edges_{0};
+};
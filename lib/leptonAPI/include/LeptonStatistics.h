@@ -0,0 +1,99 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// C/C++
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+// Latency histogram bucket upper bounds, in microseconds (the last bucket
+// holds everything above the last bound)
+constexpr size_t kLatencyBuckets{10};
+constexpr uint32_t kLatencyBucketBounds[kLatencyBuckets - 1]{
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000};
+
+
+// Capture path statistics (snapshot)
+struct LeptonStatistics {
+    uint64_t frames{0};                 // Frames returned to the caller
+    uint64_t discard_packets{0};        // Discard packets read
+    uint64_t packet_mismatches{0};      // Packets out of sequence
+    uint64_t segment_mismatches{0};     // Segments received out of order (Lepton 3)
+    uint64_t spi_resets{0};             // SPI connection resets (resync)
+    uint64_t reboots{0};                // Sensor reboots
+    uint64_t duplicate_frames{0};       // Repeated frames skipped (Lepton 2)
+    uint64_t latency_sum{0};            // Sum of the frame latencies, in microseconds
+    uint64_t latency[kLatencyBuckets]{};// Frame latency histogram (sync to frame returned)
+};
+
+
+/**
+ * @brief Capture path counters. Updated by the capture thread with relaxed
+ *        atomics, so they can be read at any time from any thread.
+ */
+class LeptonCounters {
+public:
+    LeptonCounters();
+    LeptonCounters(LeptonCounters const&) = delete;
+    LeptonCounters& operator =(LeptonCounters const&) = delete;
+
+    /**
+     * @brief Add a frame latency to the histogram
+     * @param microseconds  Latency in microseconds
+     */
+    void AddLatency(uint64_t microseconds);
+
+    /**
+     * @brief Read all counters
+     */
+    LeptonStatistics Snapshot() const;
+
+    /**
+     * @brief Clear all counters
+     */
+    void Reset();
+
+    /**
+     * @brief Increment a counter
+     */
+    static inline void Increment(std::atomic<uint64_t>& counter, uint64_t value = 1) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> discard_packets;
+    std::atomic<uint64_t> packet_mismatches;
+    std::atomic<uint64_t> segment_mismatches;
+    std::atomic<uint64_t> spi_resets;
+    std::atomic<uint64_t> reboots;
+    std::atomic<uint64_t> duplicate_frames;
+    std::atomic<uint64_t> latency_sum;
+    std::atomic<uint64_t> latency[kLatencyBuckets];
+};
@@ -0,0 +1,224 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// LePi
+#include <LeptonCommon.h>
+#include <LeptonUtils.h>
+
+// C/C++
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Linux
+#include <linux/spi/spidev.h>
+
+
+/**
+ * @brief Lepton sensor transport. Abstracts the SPI (VoSPI stream) and I2C
+ *        (CCI commands) links, so the capture path can run on top of the real
+ *        sensor or on top of a simulated one.
+ */
+class LeptonTransport {
+public:
+    virtual ~LeptonTransport() = default;
+
+    /**
+     * @brief Open SPI communication
+     * @param spi_port   SPI device id (0 -> SPI0.0, 1 -> SPI0.1)
+     * @param spi_speed  Desired SPI speed
+     * @throw Runtime error if port can't be opened or configured
+     */
+    virtual void OpenSPI(int spi_port, uint32_t spi_speed) = 0;
+
+    /**
+     * @brief Close SPI communication
+     * @param spi_port  SPI device id
+     * @throw Runtime error if port can't be closed
+     */
+    virtual void CloseSPI(int spi_port) = 0;
+
+    /**
+     * @brief Clock data out of the sensor over SPI
+     * @param buffer  Destination buffer
+     * @param size    Number of bytes to read (multiple of the packet size)
+     */
+    virtual void ReadSPI(uint8_t* buffer, size_t size) = 0;
+
+    /**
+     * @brief Clock a batch of packets out of the sensor, in a single transfer
+     * @param buffer       Destination buffer
+     * @param num_packets  Number of packets to read
+     * @param packet_size  Packet size in bytes
+     */
+    virtual void ReadSPIPackets(uint8_t* buffer, uint16_t num_packets, uint16_t packet_size) {
+        ReadSPI(buffer, static_cast<size_t>(num_packets) * packet_size);
+    }
+
+    /**
+     * @brief Largest number of bytes that can be read in a single transfer
+     */
+    virtual size_t MaxTransferSize() const {
+        return SIZE_MAX;
+    }
+
+    /**
+     * @brief Open I2C communication with Lepton sensor
+     * @throw Runtime error if communication can't be established
+     */
+    virtual void ConnectI2C() = 0;
+
+    /**
+     * @brief Close I2C communication with Lepton sensor
+     * @throw Runtime error if communication can't be closed
+     */
+    virtual void DisconnectI2C() = 0;
+
+    /**
+     * @brief Sensor I2C commands, see LeptonUtils.h
+     * @return Return true if operation succeed, false otherwise
+     */
+    virtual bool ShutterOpen() = 0;
+    virtual bool ShutterClose() = 0;
+    virtual bool FFC() = 0;
+    virtual bool Reboot() = 0;
+
+    /**
+     * @brief Get thermal sensor core temperature
+     * @return Return sensor temperature in Kelvins (scaled by 100)
+     */
+    virtual unsigned int InternalTemp() = 0;
+
+    /**
+     * @brief Get thermal sensor number/version
+     * @return Return sensor number/version
+     */
+    virtual unsigned int SensorNumber() = 0;
+
+    /**
+     * @brief Turn on the sensor VSYNC output, and open the edge source it is
+     *        wired to
+     * @param gpio         Raspberry Pi GPIO wired to the Lepton GPIO3 pin
+     * @param phase_delay  VSYNC phase delay in lines, [-3, 3]
+     * @return true, if VSYNC is available, false otherwise
+     */
+    virtual bool EnableVsync(unsigned int /*gpio*/, int /*phase_delay*/) {
+        return false;
+    }
+
+    /**
+     * @brief Turn off the sensor VSYNC output, and close its edge source
+     */
+    virtual void DisableVsync() {
+    }
+
+    /**
+     * @brief Wait for the next VSYNC edge (new frame/segment ready to be read)
+     * @param timeout  Max wait time in microseconds
+     * @return true, on VSYNC edge, false on timeout
+     */
+    virtual bool WaitVsync(uint32_t timeout) {
+        Wait(timeout);
+        return false;
+    }
+
+    /**
+     * @brief Select the telemetry rows sent with each frame
+     * @param mode  Telemetry off, or rows sent before/after the image rows
+     * @return true, if the sensor sends the requested rows, false otherwise
+     */
+    virtual bool SetTelemetry(LeptonTelemetryMode mode) {
+        return mode == TELEMETRY_OFF;
+    }
+
+    /**
+     * @brief Wait for the sensor (reset, reboot and resync pacing)
+     * @param microseconds  Wait time in microseconds
+     */
+    virtual void Wait(uint32_t microseconds) = 0;
+};
+
+
+/**
+ * @brief Transport for a Lepton sensor wired to the Raspberry Pi SPI and I2C
+ *        ports (spidev + Lepton SDK). Each transport owns its SPI device and
+ *        I2C port, so several sensors can be driven from one process.
+ */
+class LeptonHardwareTransport : public LeptonTransport {
+public:
+    /**
+     * @brief Hardware transport constructor
+     * @param i2c_port  I2C bus the sensor is wired to
+     */
+    explicit LeptonHardwareTransport(uint16_t i2c_port = kI2CPortID)
+            : i2c_port_id_{i2c_port} {}
+    LeptonHardwareTransport(LeptonHardwareTransport const&) = delete;
+    LeptonHardwareTransport& operator =(LeptonHardwareTransport const&) = delete;
+    virtual ~LeptonHardwareTransport() = default;
+
+    void OpenSPI(int spi_port, uint32_t spi_speed) override;
+    void CloseSPI(int spi_port) override;
+    void ReadSPI(uint8_t* buffer, size_t size) override;
+    void ReadSPIPackets(uint8_t* buffer, uint16_t num_packets, uint16_t packet_size) override;
+    size_t MaxTransferSize() const override;
+
+    void ConnectI2C() override;
+    void DisconnectI2C() override;
+    bool ShutterOpen() override;
+    bool ShutterClose() override;
+    bool FFC() override;
+    bool Reboot() override;
+    unsigned int InternalTemp() override;
+    unsigned int SensorNumber() override;
+
+    bool EnableVsync(unsigned int gpio, int phase_delay) override;
+    void DisableVsync() override;
+    bool WaitVsync(uint32_t timeout) override;
+
+    bool SetTelemetry(LeptonTelemetryMode mode) override;
+
+    void Wait(uint32_t microseconds) override;
+
+private:
+    // SPI device
+    int spi_fd_{-1};
+
+    // I2C port
+    LeptonI2CPort i2c_port_;
+    uint16_t i2c_port_id_;
+
+    // SPI bulk transfer descriptors (one per packet)
+    std::vector<spi_ioc_transfer> transfers_;
+    uint32_t spi_speed_{0};
+    size_t max_transfer_size_{4096};
+
+    // VSYNC GPIO (sysfs value file, polled for edges)
+    unsigned int vsync_gpio_{0};
+    int vsync_fd_{-1};
+};
@@ -0,0 +1,115 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// LePi
+#include <LeptonCommon.h>
+
+// C/C++
+#include <cstdint>
+
+
+/**
+ * @brief Unpack VoSPI packets to a U16 frame. The 4 bytes header of every packet
+ *        is skipped, and the pixels (big endian on the wire) are swapped to the
+ *        host byte order. Uses NEON on ARM, AVX2/SSE2 on x86, and a scalar loop
+ *        otherwise (selected at compile time).
+ * @param packets      VoSPI packets (header + payload)
+ * @param num_packets  Number of packets
+ * @param packet_size  Packet size in bytes (header included)
+ * @param frame        Output frame, must fit num_packets * (packet_size - 4) bytes
+ */
+void LeptonUnpack16(const uint8_t* packets,
+                    uint32_t num_packets,
+                    uint32_t packet_size,
+                    uint16_t* frame);
+
+/**
+ * @brief Scalar reference of LeptonUnpack16
+ */
+void LeptonUnpack16Scalar(const uint8_t* packets,
+                          uint32_t num_packets,
+                          uint32_t packet_size,
+                          uint16_t* frame);
+
+/**
+ * @brief Unpack VoSPI packets to a U16 frame, and find the frame min and max
+ *        in the same pass (vectorized reduction). The packets are not modified.
+ * @param packets      VoSPI packets (header + payload)
+ * @param num_packets  Number of packets
+ * @param packet_size  Packet size in bytes (header included)
+ * @param frame        Output frame, must fit num_packets * (packet_size - 4) bytes
+ * @param min_value    Frame min value
+ * @param max_value    Frame max value
+ */
+void LeptonUnpack16MinMax(const uint8_t* packets,
+                          uint32_t num_packets,
+                          uint32_t packet_size,
+                          uint16_t* frame,
+                          uint16_t& min_value,
+                          uint16_t& max_value);
+
+/**
+ * @brief Find the min and max values of a U16 frame (vectorized reduction)
+ * @param frame      Input frame
+ * @param size       Number of pixels
+ * @param min_value  Frame min value
+ * @param max_value  Frame max value
+ */
+void LeptonMinMax(const uint16_t* frame,
+                  uint32_t size,
+                  uint16_t& min_value,
+                  uint16_t& max_value);
+
+/**
+ * @brief Scale a U16 frame from [min_value, max_value] to [0, 255], using fixed
+ *        point arithmetic. A flat frame (min_value == max_value) is mapped to 0.
+ * @param frame      Input frame
+ * @param size       Number of pixels
+ * @param min_value  Frame min value
+ * @param max_value  Frame max value
+ * @param frame_u8   Output frame
+ */
+void LeptonScale8(const uint16_t* frame,
+                  uint32_t size,
+                  uint16_t min_value,
+                  uint16_t max_value,
+                  uint8_t* frame_u8);
+
+/**
+ * @brief Decode the telemetry row A packet into the frame metadata
+ * @param packet    Telemetry row A VoSPI packet (header + payload)
+ * @param metadata  Output frame metadata
+ */
+void LeptonUnpackTelemetry(const uint8_t* packet, LeptonFrameMetadata& metadata);
+
+/**
+ * @brief Name of the unpack kernel selected at compile time
+ * @return "NEON", "AVX2", "SSE2" or "scalar"
+ */
+const char* LeptonUnpackKernel();
@@ -42,23 +42,23 @@
 
 
 //------------------------------- SPI ----------------------------------------//
-// SPI Config
-extern int spi_fd;
-
 /**
  * @brief Open SPI communication
- * @param spi_device  SPI device id
+ * @param spi_device  SPI device id (SPI0 chip select: 0 -> /dev/spidev0.0,
+ *                    1 -> /dev/spidev0.1)
  * @param spi_speed   Desired SPI speed
+ * @return SPI device file descriptor
  * @throw Runtime error if port can't be opened or configured
  */
-void leptonSPI_OpenPort(int spi_device, uint32_t spi_speed);
+int leptonSPI_OpenPort(int spi_device, uint32_t spi_speed);
 
 /**
  * @brief Close SPI communication
  * @param spi_device  SPI device id
+ * @param spi_fd      SPI device file descriptor
  * @throw Runtime error if port can't be closed
  */
-void leptonSPI_ClosePort(int spi_device);
+void leptonSPI_ClosePort(int spi_device, int spi_fd);
 
 //------------------------------- I2C ----------------------------------------//
 // I2C config
@@ -66,56 +66,109 @@ constexpr LEP_UINT16 kI2CPortID{1};
 constexpr LEP_UINT16 kI2CPortBaudRate{400};
 constexpr LEP_CAMERA_PORT_E kI2CPortType{LEP_CCI_TWI};
 
+// I2C port of one sensor. The commands below fail on a port not connected.
+struct LeptonI2CPort {
+    LEP_CAMERA_PORT_DESC_T desc;
+    bool connected{false};
+};
+
 /**
  * @brief Open I2C communication with Lepton sensor
+ * @param port     Sensor I2C port
+ * @param port_id  I2C bus the sensor is wired to
  * @throw Runtime error if communication can't be established
  */
-void leptonI2C_connect();
+void leptonI2C_connect(LeptonI2CPort& port, LEP_UINT16 port_id = kI2CPortID);
 
 /**
  * @brief Close I2C communication with Lepton sensor
+ * @param port  Sensor I2C port
  * @throw Runtime error if communication can't be closed
  */
-void leptonI2C_disconnect();
+void leptonI2C_disconnect(LeptonI2CPort& port);
 
 /**
  * @brief Open shutter
  * @return Return true if operation succeed, false otherwise
  */
-bool leptonI2C_ShutterOpen();
+bool leptonI2C_ShutterOpen(LeptonI2CPort& port);
 
 /**
  * @brief Run FFC
  * @return Return true if operation succeed, false otherwise
  */
-bool leptonI2C_FFC();
+bool leptonI2C_FFC(LeptonI2CPort& port);
 
 /**
  * @brief Close shutter
  * @return Return true if operation succeed, false otherwise
  */
-bool leptonI2C_ShutterClose();
+bool leptonI2C_ShutterClose(LeptonI2CPort& port);
 
 /**
  * @brief Reboot lepton sensor
  * @return Return true if operation succeed, false otherwise
  */
-bool leptonI2C_Reboot();
+bool leptonI2C_Reboot(LeptonI2CPort& port);
 
 /**
  * @brief Set shutter mode to manual
  * @return Return true if operation succeed, false otherwise
  */
-bool leptonI2C_ShutterManual();
+bool leptonI2C_ShutterManual(LeptonI2CPort& port);
 
 /**
  * @brief Get thermal sensor core temperature
  * @return Return sensor temperature in Kelvins
  */
-unsigned int leptonI2C_InternalTemp();
+unsigned int leptonI2C_InternalTemp(LeptonI2CPort& port);
 
 /**
  * @brief Get thermal sensor number/version
  * @return Return senors number/version
  */
-unsigned int leptonI2C_SensorNumber();
+unsigned int leptonI2C_SensorNumber(LeptonI2CPort& port);
+
+/**
+ * @brief Turn the Lepton GPIO3 pin into a VSYNC output (pulse on each new
+ *        frame/segment)
+ * @param phase_delay  VSYNC phase delay in lines, [-3, 3]
+ * @return Return true if operation succeed, false otherwise
+ */
+bool leptonI2C_EnableVsync(LeptonI2CPort& port, int phase_delay);
+
+/**
+ * @brief Turn the Lepton GPIO3 pin back into a plain GPIO
+ * @return Return true if operation succeed, false otherwise
+ */
+bool leptonI2C_DisableVsync(LeptonI2CPort& port);
+
+/**
+ * @brief Turn on the telemetry rows of the VoSPI stream
+ * @param header  Send the telemetry rows before (true) or after (false) the
+ *                image rows
+ * @return Return true if operation succeed, false otherwise
+ */
+bool leptonI2C_EnableTelemetry(LeptonI2CPort& port, bool header);
+
+/**
+ * @brief Turn off the telemetry rows of the VoSPI stream
+ * @return Return true if operation succeed, false otherwise
+ */
+bool leptonI2C_DisableTelemetry(LeptonI2CPort& port);
+
+//------------------------------- GPIO ---------------------------------------//
+/**
+ * @brief Export a GPIO as input with rising edge events (sysfs)
+ * @param gpio  GPIO number
+ * @return Value file descriptor, which can be polled (POLLPRI) for edges
+ * @throw Runtime error if GPIO can't be configured
+ */
+int leptonGPIO_OpenEdge(unsigned int gpio);
+
+/**
+ * @brief Close and unexport a GPIO opened by leptonGPIO_OpenEdge
+ * @param gpio  GPIO number
+ * @param fd    Value file descriptor
+ */
+void leptonGPIO_Close(unsigned int gpio, int fd);
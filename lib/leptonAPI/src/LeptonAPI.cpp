@@ -28,39 +28,120 @@
 // LePi
 #include <LeptonCommon.h>
 #include <LeptonAPI.h>
-#include <LeptonUtils.h>
+#include <LeptonTransport.h>
+#include <LeptonUnpack.h>
 
 // C/C++
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <sys/mman.h>
 
 
+/**
+ * @brief 64 bit FNV-1a style hash, one 8 bytes word at a time
+ */
+static uint64_t FrameHash(const uint8_t* data, size_t size) {
+    uint64_t hash{0xCBF29CE484222325ull};
+    size_t i{0};
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ull;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+
+LePi::LePi(std::shared_ptr<LeptonTransport> transport,
+           const LeptonCaptureOptions& options)
+        : transport_(transport),
+          options_(options),
+          spi_port_{options.spi_port} {
+
+    // Default to the sensor wired to the Raspberry Pi
+    if (!transport_) {
+        transport_ = std::make_shared<LeptonHardwareTransport>(options.i2c_port);
+    }
+}
+
+LePi::~LePi() {
+    // Release the locked frame buffers
+    if (options_.lock_memory) {
+        munlock(frame_buffer_.data(), frame_buffer_.size() * sizeof(uint16_t));
+        munlock(unpack_buffer_.data(), unpack_buffer_.size() * sizeof(uint16_t));
+    }
+}
+
 // Open communication with Lepton
 bool LePi::OpenConnection()
 {
+    std::lock_guard<std::mutex> lock(i2c_lock_);
+
     // Open I2C
+    LeptonType type{LEPTON_UNKNOWN};
     try {
-        leptonI2C_connect();
-        usleep(kLeptonLoadTime);
+        transport_->ConnectI2C();
+        transport_->Wait(kLeptonLoadTime);
         // Read sensor type and prepare config params
-        config_ = LeptonCameraConfig(GetType());
+        type = GetType();
     }
     catch (...) {
         std::cerr << "Unable to open connection (I2C) with the sensor." << std::endl;
         return false;
     }
 
+    // Telemetry rows, falls back to image rows only if not available
+    telemetry_ = options_.telemetry;
+    if (telemetry_ != TELEMETRY_OFF && !transport_->SetTelemetry(telemetry_)) {
+        std::cerr << "Unable to enable telemetry, frame metadata not available." << std::endl;
+        telemetry_ = TELEMETRY_OFF;
+    }
+    try {
+        config_ = LeptonCameraConfig(type, telemetry_);
+    }
+    catch (...) {
+        return false;
+    }
+
+    // VSYNC output, falls back to timed sync if not available
+    vsync_ = options_.vsync &&
+             transport_->EnableVsync(options_.vsync_gpio, options_.vsync_phase_delay);
+    if (options_.vsync && !vsync_) {
+        std::cerr << "Unable to enable VSYNC, using timed sync." << std::endl;
+    }
+
     // Open SPI port
     try {
-        leptonSPI_OpenPort(spi_port_, config_.spi_speed);
+        transport_->OpenSPI(spi_port_, config_.spi_speed);
     }
     catch (...) {
         std::cerr << "Unable to open connection (SPI) with the sensor." << std::endl;
         return false;
     }
 
+    // Bulk read: read as many packets per SPI transfer as the port allows
+    // (the last transfer of a segment may be shorter)
+    if (options_.read_mode == READ_BULK) {
+        const size_t max_packets{transport_->MaxTransferSize() / config_.packet_size};
+        config_.packets_per_read = static_cast<uint16_t>(std::max<size_t>(1,
+            std::min<size_t>(max_packets, config_.packets_per_segment)));
+    }
+
     // Prepare frame buffer
-    // Note: each image line comes with 4 bytes header
-    frame_buffer_.resize((config_.width + 4) * config_.height);
+    // Note: each packet comes with 4 bytes header, telemetry rows included
+    frame_buffer_.resize(config_.segment_size_uint16 * config_.segments_per_frame);
+    unpack_buffer_.resize(config_.width * config_.height);
+
+    // Keep the frame buffers in memory, so the SPI reads never page fault
+    if (options_.lock_memory &&
+        (mlock(frame_buffer_.data(), frame_buffer_.size() * sizeof(uint16_t)) != 0 ||
+         mlock(unpack_buffer_.data(), unpack_buffer_.size() * sizeof(uint16_t)) != 0)) {
+        std::cerr << "Unable to lock the frame buffers in memory." << std::endl;
+    }
 
     return true;
 }
@@ -68,12 +149,19 @@ bool LePi::OpenConnection()
 // Close communication with Lepton
 bool LePi::CloseConnection()
 {
+    std::lock_guard<std::mutex> lock(i2c_lock_);
     try {
+        // Turn off VSYNC
+        if (vsync_) {
+            transport_->DisableVsync();
+            vsync_ = false;
+        }
+
         // Close SPI port
-        leptonSPI_ClosePort(spi_port_);
+        transport_->CloseSPI(spi_port_);
 
         // Close I2C port
-        leptonI2C_disconnect();
+        transport_->DisconnectI2C();
     }
     catch (...) {
         std::cerr << "Unable to close connection (I2C/SPI) with the sensor." << std::endl;
@@ -86,7 +174,7 @@ bool LePi::CloseConnection()
 // Reset communication with Lepton
 bool LePi::ResetConnection() {
     bool result_close = CloseConnection();
-    usleep(kLeptonResetTime);
+    transport_->Wait(kLeptonResetTime);
     bool result_open = OpenConnection();
     return result_close && result_open;
 }
@@ -96,18 +184,19 @@ bool LePi::ResetSPIConnection() {
 
     // Close SPI port
     try {
-        leptonSPI_ClosePort(spi_port_);
+        transport_->CloseSPI(spi_port_);
     }
     catch (...) {
         std::cerr << "Unable to close connection (SPI) with the sensor." << std::endl;
         return false;
     }
 
-    usleep(kLeptonResetTime);
+    transport_->Wait(kLeptonResetTime);
+    LeptonCounters::Increment(counters_.spi_resets);
 
     // Open spi port
     try {
-        leptonSPI_OpenPort(spi_port_, config_.spi_speed);
+        transport_->OpenSPI(spi_port_, config_.spi_speed);
     }
     catch (...) {
         std::cerr << "Unable to open connection (SPI) with the sensor." << std::endl;
@@ -118,11 +207,15 @@ bool LePi::ResetSPIConnection() {
 
 // Reboot sensor and reset connection
 bool LePi::RebootSensor() {
-    leptonI2C_Reboot(); // This function can return a false value even when reboot 
-                        // succeed, due to the I2C read after reboot, avoid using 
-                        // the returned value for now
+    {
+        std::lock_guard<std::mutex> lock(i2c_lock_);
+        transport_->Reboot(); // This function can return a false value even when reboot
+                              // succeed, due to the I2C read after reboot, avoid using
+                              // the returned value for now
+    }
     bool result_close = CloseConnection();
-    usleep(kLeptonRebootTime);
+    transport_->Wait(kLeptonRebootTime);
+    LeptonCounters::Increment(counters_.reboots);
     bool result_open = OpenConnection();
     return result_close && result_open;
 }
@@ -130,95 +223,87 @@ bool LePi::RebootSensor() {
 // Lepton convert frame from sensor to IR imageU8
 void LePi::LeptonUnpackFrame8 (uint8_t *frame) {
 
-    // Prepare buffer pointers
-    const uint32_t frame_size{config_.segments_per_frame*config_.segment_size_uint16};
-    auto frame_u8 = reinterpret_cast<uint8_t *>(frame_buffer_.data());
-
-    // Compute min and max
-    uint16_t minValue = 65535;
-    uint16_t maxValue = 0;
-    for(uint32_t i = 0; i < frame_size; i++) {
-
-        // Skip the first 2 uint16_t's of every packet, they're 4 bytes header
-        if(i % config_.packet_size_uint16 < 2) {
-            continue;
-        }
-
-        // Flip the MSB and LSB at the last second
-        uint8_t temp = frame_u8[i*2];
-        frame_u8[i*2] = frame_u8[i*2+1];
-        frame_u8[i*2+1] = temp;
-
-        // Check min/max value
-        uint16_t value = frame_buffer_[i];
-        if(value > maxValue) {
-            maxValue = value;
-        }
-        if(value < minValue) {
-            minValue = value;
-        }
-    }
+    // Unpack frame and find its min and max in a single pass (the raw frame
+    // buffer is left untouched, telemetry rows are skipped)
+    const uint8_t* image{reinterpret_cast<const uint8_t *>(frame_buffer_.data()) +
+                         config_.image_packet_index * config_.packet_size};
+    uint16_t minValue{0};
+    uint16_t maxValue{0};
+    LeptonUnpack16MinMax(image, config_.image_packets, config_.packet_size,
+                         unpack_buffer_.data(), minValue, maxValue);
 
     // Scale frame range
-    auto diff = static_cast<float>(maxValue - minValue);
-    float scale = 255.f / diff;
-    int idx = 0;
-    for(uint32_t i = 0; i < frame_size; i++) {
-
-        // Skip the first 2 uint16_t's of every packet, they're 4 bytes header
-        if(i % config_.packet_size_uint16 < 2) {
-            continue;
-        }
-
-        frame[idx++] = static_cast<uint8_t>((frame_buffer_[i] - minValue) * scale);
-    }
+    LeptonScale8(unpack_buffer_.data(), unpack_buffer_.size(), minValue, maxValue, frame);
 }
 
 // Lepton convert frame from sensor to IR imageU16
 void LePi::LeptonUnpackFrame16 (uint16_t *frame)
 {
-    auto src = reinterpret_cast<uint8_t *>(frame_buffer_.data());
-    auto dst = reinterpret_cast<uint8_t *>(frame);
-    int idx = 0;
-    const uint32_t frame_size{config_.segments_per_frame*config_.segment_size};
-    for(uint32_t i = 0; i < frame_size; i+=2) {
-
-        // Skip the first 2 uint16_t's of every packet, they're 4 header bytes
-        if(i % config_.packet_size < 4) {
-            continue;
-        }
+    // Telemetry rows are skipped
+    const uint8_t* image{reinterpret_cast<const uint8_t *>(frame_buffer_.data()) +
+                         config_.image_packet_index * config_.packet_size};
+    LeptonUnpack16(image, config_.image_packets, config_.packet_size, frame);
+}
 
-        // Flip the MSB and LSB
-        dst[idx++] = src[i+1];
-        dst[idx++] = src[i];
-    }
+// Lepton read stop check (the reads run until stopped, when a run flag is given)
+static bool LeptonStopped(const std::atomic<bool>* run)
+{
+    return run != nullptr && !run->load(std::memory_order_relaxed);
 }
 
 // Lepton read segment from sensor
-int LePi::LeptonReadSegment(const int max_resets, uint8_t *data_buffer)
+int LePi::LeptonReadSegment(const int max_resets, uint8_t *data_buffer,
+                            const std::atomic<bool>* run)
 {
     int resets{-1};
-    const int step{config_.packets_per_read};
-    const int bytes_per_SPI_read{step * config_.packet_size};
 
-    for(int j = 0; j < config_.packets_per_segment; j+=step)
+    for(int j = 0, step = 0; j < config_.packets_per_segment; j+=step)
     {
+        // Packets in this batch (the last one may be shorter)
+        step = std::min<int>(config_.packets_per_read, config_.packets_per_segment - j);
+
         // Try to reach sync first
         if (j == 0) {
             uint8_t packetNumber{255};
             uint8_t discard_packet{0x0F};
             while (packetNumber != 0 || discard_packet == 0x0F) { // while packet id is not 0, or the packet is a discard packet
                 ++resets;
-                if(resets == max_resets) {
-                    return resets;
+                if(resets == max_resets || LeptonStopped(run)) {
+                    return max_resets;
                 }
 
-                usleep(config_.reset_wait_time);
-                read(spi_fd, data_buffer, config_.packet_size);
+                // Wait for the sensor VSYNC (a few packets are read after each
+                // edge), or just wait before each read
+                if (vsync_) {
+                    if (resets % kVsyncSyncPackets == 0) {
+                        transport_->WaitVsync(kLeptonVsyncTimeout);
+                    }
+                }
+                else {
+                    transport_->Wait(config_.reset_wait_time);
+                }
+                transport_->ReadSPI(data_buffer, config_.packet_size);
                 packetNumber = data_buffer[1];
                 discard_packet = data_buffer[0] & 0x0F;
+                if (discard_packet == 0x0F) {
+                    LeptonCounters::Increment(counters_.discard_packets);
+                }
+                else if (packetNumber != 0) {
+                    LeptonCounters::Increment(counters_.packet_mismatches);
+                }
+            }
+            sync_time_ = std::chrono::steady_clock::now();
+
+            // Read the rest of the first batch
+            if (step > 1) {
+                transport_->ReadSPIPackets(data_buffer + config_.packet_size,
+                                           step - 1, config_.packet_size);
+                if (!LeptonCheckPackets(data_buffer, 1, step - 1)) {
+                    transport_->Wait(config_.reset_wait_time);
+                    ++resets;
+                    j = -step; // reset just the segment
+                }
             }
-            read(spi_fd, data_buffer + config_.packet_size, (step - 1) * config_.packet_size);
             continue;
         }
 
@@ -227,43 +312,47 @@ int LePi::LeptonReadSegment(const int max_resets, uint8_t *data_buffer)
             return resets;
         }
 
-        // Read a packet
-        read(spi_fd, data_buffer + j * config_.packet_size, bytes_per_SPI_read);
+        // Read a batch of packets
+        transport_->ReadSPIPackets(data_buffer + j * config_.packet_size,
+                                   step, config_.packet_size);
 
-        // Checks discard packet
-        auto discard_packet = data_buffer[j * config_.packet_size] & 0x0F;
-        if (discard_packet == 0x0F) {
-            usleep(config_.reset_wait_time);
-            ++resets;
-            j = -step;
-            continue;
-        }
-
-        // Checks first packet id
-        uint8_t packetNumber = data_buffer[j * config_.packet_size + 1];
-        if (packetNumber != j) {
-            usleep(config_.reset_wait_time);
+        // Checks discard packets and packet ids
+        if (!LeptonCheckPackets(data_buffer, j, step)) {
+            transport_->Wait(config_.reset_wait_time);
             ++resets;
             j = -step; // reset just the segment
             continue;
         }
-
-        // Checks last packet id
-        /*int last_idx_in_packet = j + step_minus_1;
-        uint8_t packetNumber_last = data_buffer[last_idx_in_packet * PACKET_SIZE + 1];
-        if (packetNumber_last != last_idx_in_packet) {
-            usleep(RESET_WAIT_TIME);
-            ++resets;
-            j = -step; // reset just the segment
-            continue;
-        }*/
     }
 
     return resets;
 }
 
+// Lepton check received packets
+bool LePi::LeptonCheckPackets(const uint8_t* data_buffer,
+                              int first_packet,
+                              int num_packets)
+{
+    for (int j = first_packet; j < first_packet + num_packets; ++j) {
+        const uint8_t* packet = data_buffer + j * config_.packet_size;
+
+        // Checks discard packet
+        if ((packet[0] & 0x0F) == 0x0F) {
+            LeptonCounters::Increment(counters_.discard_packets);
+            return false;
+        }
+
+        // Checks packet id
+        if (packet[1] != j) {
+            LeptonCounters::Increment(counters_.packet_mismatches);
+            return false;
+        }
+    }
+    return true;
+}
+
 // Read frame from lepton sensor
-int LePi::LeptonReadFrame()
+int LePi::LeptonReadFrame(const std::atomic<bool>* run)
 {
     // Compute packet index for the packet containing the segment ID
     const int segmentId_packet_idx{config_.segment_number_packet_index * config_.packet_size};
@@ -275,6 +364,11 @@ int LePi::LeptonReadFrame()
     int16_t num_segments{static_cast<int16_t>(config_.segments_per_frame)};
     for(int16_t segment = 0; segment < num_segments; ++segment)
     {
+        // Stopped while waiting for sync
+        if (LeptonStopped(run)) {
+            return -1;
+        }
+
         // Check if reset SPI connection is required
         if(resets > kMaxResetsPerFrame) {
             resets = 0;
@@ -285,18 +379,28 @@ int LePi::LeptonReadFrame()
 
         // Read segment
         uint8_t* data_buffer = buffer + segment * config_.segment_size;
-        int segment_num_resets = LeptonReadSegment(kMaxResetsPerSegment, data_buffer);
+        int segment_num_resets = LeptonReadSegment(kMaxResetsPerSegment, data_buffer, run);
+        if (LeptonStopped(run)) {
+            return -1;
+        }
         if (segment_num_resets == kMaxResetsPerSegment) {
             segment = -1;
             LeptonResync(resetsToReboot);
             continue;
         }
+        if (segment == 0) {
+            frame_time_ = sync_time_;
+        }
 
         // If Lepton module with more than 1 segment
         if (config_.segments_per_frame > 1) {
             // Checks segment number
             int16_t segmentNumber = (data_buffer[segmentId_packet_idx] >> 4) - 1;
             if (segmentNumber != segment) {
+                // Segment number 0 marks an invalid frame, not a lost segment
+                if (segmentNumber >= 0) {
+                    LeptonCounters::Increment(counters_.segment_mismatches);
+                }
                 ++resets;
                 segment = -1; // reset all segments
                 continue;
@@ -304,9 +408,27 @@ int LePi::LeptonReadFrame()
         }
     }
 
+    // Frame metadata
+    if (telemetry_ != TELEMETRY_OFF) {
+        LeptonUnpackTelemetry(buffer + config_.telemetry_packet_index * config_.packet_size,
+                              metadata_);
+    }
+
     return resets;
 }
 
+// Lepton check if the received frame is a repeat
+bool LePi::LeptonDuplicateFrame()
+{
+    // The telemetry frame counter identifies the frame, no need to hash it
+    const uint64_t hash{telemetry_ != TELEMETRY_OFF ? metadata_.frame_counter :
+                        FrameHash(reinterpret_cast<const uint8_t *>(frame_buffer_.data()),
+                                  config_.segments_per_frame * config_.segment_size)};
+    const bool duplicate{hash == frame_hash_};
+    frame_hash_ = hash;
+    return duplicate;
+}
+
 void LePi::LeptonResync(uint16_t &resetsToReboot) {
 
     // Re-sync by reboot
@@ -326,7 +448,8 @@ void LePi::LeptonResync(uint16_t &resetsToReboot) {
 }
 
 // Lepton get IR frame from sensor
-bool LePi::GetFrame(void *frame, LeptonFrameType type)
+bool LePi::GetFrame(void *frame, LeptonFrameType type, LeptonFrameMetadata* metadata,
+                    const std::atomic<bool>* run)
 {
 
     // Force reboot if user signaled one
@@ -337,9 +460,20 @@ bool LePi::GetFrame(void *frame, LeptonFrameType type)
         force_reboot_ = false;
     }
 
-    // Read data packets from Lepton over SPI
-    // TODO: add a time out, and throw an error when a new frame can't be read
-    LeptonReadFrame();
+    // Read data packets from Lepton over SPI, skipping the repeated frames.
+    // The reads resync until a frame is read, or the run flag is cleared
+    uint16_t duplicates{0};
+    if (LeptonReadFrame(run) < 0) {
+        return false;
+    }
+    while (options_.drop_duplicates && LeptonDuplicateFrame() &&
+           duplicates < kMaxDuplicateFrames) {
+        ++duplicates;
+        if (LeptonReadFrame(run) < 0) {
+            return false;
+        }
+    }
+    LeptonCounters::Increment(counters_.duplicate_frames, duplicates);
 
     // Convert Lepton frame to IR frame
     if (type == FRAME_U8) {
@@ -352,7 +486,12 @@ bool LePi::GetFrame(void *frame, LeptonFrameType type)
         std::cerr << "Unknown frame type." << std::endl;
         return false;
     }
-    count_++;
+    if (metadata) {
+        *metadata = metadata_;
+    }
+    LeptonCounters::Increment(counters_.frames);
+    counters_.AddLatency(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - frame_time_).count());
 
     return true;
 }
@@ -377,24 +516,28 @@ bool LePi::SendCommand(LeptonI2CCmd cmd, void* buffer)
         }
         case FFC:
         {
-            result = leptonI2C_FFC();
+            std::lock_guard<std::mutex> lock(i2c_lock_);
+            result = transport_->FFC();
             break;
         }
         case SENSOR_TEMP_K:
         {
+            std::lock_guard<std::mutex> lock(i2c_lock_);
             auto frame_int = static_cast<unsigned int *>(buffer);
-            frame_int[0] = leptonI2C_InternalTemp();
+            frame_int[0] = transport_->InternalTemp();
             result = frame_int[0] != 0;
             break;
         }
         case SHUTTER_OPEN:
         {
-            result = leptonI2C_ShutterOpen();
+            std::lock_guard<std::mutex> lock(i2c_lock_);
+            result = transport_->ShutterOpen();
             break;
         }
         case SHUTTER_CLOSE:
         {
-            result = leptonI2C_ShutterClose();
+            std::lock_guard<std::mutex> lock(i2c_lock_);
+            result = transport_->ShutterClose();
             break;
         }
         default:
@@ -411,7 +554,7 @@ bool LePi::SendCommand(LeptonI2CCmd cmd, void* buffer)
 // Get lepton version
 LeptonType LePi::GetType() {
 
-    auto it = kMapLeptonType.find(leptonI2C_SensorNumber());
+    auto it = kMapLeptonType.find(transport_->SensorNumber());
     if (it != kMapLeptonType.end()) {
         return it->second;
     }
@@ -27,23 +27,44 @@
 
 // LePi
 #include <LeptonCommon.h>
-#include <LeptonUtils.h>
 #include <LeptonAPI.h>
 #include <LeptonCamera.h>
+#include <LeptonUnpack.h>
 
 // C/C++
+#include <chrono>
+#include <algorithm>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 
 
-LeptonCamera::LeptonCamera()
+// Triple buffer middle slot: frame index + new frame flag
+constexpr uint8_t kFrameIndex{0x7F};
+constexpr uint8_t kFrameFresh{0x80};
+
+
+LeptonCamera::LeptonCamera(std::shared_ptr<LeptonTransport> transport,
+                           const LeptonCaptureOptions& options)
         : grabber_thread_(),
           run_thread_{false},
-          has_frame_{false},
-          lePi_(),
-          sensor_temperature_{0.0} {
+          options_(options),
+          frame_write_{0},
+          frame_read_{1},
+          frame_middle_{2},
+          frame_event_fd_{-1},
+          frame_id_{0},
+          housekeeping_thread_(),
+          housekeeping_period_{options.housekeeping_period},
+          lePi_(transport, options),
+          sensor_temperature_{0.0},
+          telemetry_temperature_{false} {
 
     // Open communication with the sensor
     if (!lePi_.OpenConnection()) {
@@ -57,10 +78,39 @@ LeptonCamera::LeptonCamera()
         throw std::runtime_error("Unknown lepton type.");
     }
 
-    // Prepare buffers
+    // Prepare buffers: 3 triple buffer slots, plus the spare slots that
+    // replace the leased frames
     lepton_config_ = LeptonCameraConfig(lepton_type_);
-    frame_to_read_.resize(lepton_config_.width * lepton_config_.height);
-    frame_to_write_.resize(lepton_config_.width * lepton_config_.height);
+    const size_t num_frames{3u + std::min<size_t>(options.frame_leases, kFrameIndex - 2u)};
+    frames_.resize(num_frames);
+    for (auto& slot : frames_) {
+        slot = std::make_shared<LeptonFrameSlot>();
+        slot->frame.pixels.resize(lepton_config_.width * lepton_config_.height);
+    }
+    parked_frames_.reserve(num_frames);
+    spare_frames_.reserve(num_frames);
+    for (size_t i = 3; i < num_frames; ++i) {
+        spare_frames_.push_back(static_cast<uint8_t>(i));
+    }
+    frame_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (frame_event_fd_ < 0) {
+        std::cerr << "Unable to create the frame event" << std::endl;
+        throw std::runtime_error("Frame event failed.");
+    }
+    frame_ring_ = std::make_shared<LeptonFrameRing>(options.frame_ring_size,
+                                                    lepton_config_.width * lepton_config_.height);
+
+    // Keep the capture buffers in memory, so the grabber never page faults
+    if (options.lock_memory) {
+        bool locked{frame_ring_->lockMemory()};
+        for (auto& slot : frames_) {
+            const std::vector<uint16_t>& pixels = slot->frame.pixels;
+            locked = mlock(pixels.data(), pixels.size() * sizeof(uint16_t)) == 0 && locked;
+        }
+        if (!locked) {
+            std::cerr << "Unable to lock the capture buffers in memory." << std::endl;
+        }
+    }
 };
 
 LeptonCamera::~LeptonCamera() {
@@ -71,6 +121,12 @@ LeptonCamera::~LeptonCamera() {
     if (!lePi_.CloseConnection()) {
         std::cerr << "Unable to close communication with the sensor" << std::endl;
     }
+    close(frame_event_fd_);
+    if (options_.lock_memory) {
+        for (auto& slot : frames_) {
+            munlock(slot->frame.pixels.data(), slot->frame.pixels.size() * sizeof(uint16_t));
+        }
+    }
 };
 
 void LeptonCamera::start() {
@@ -78,7 +134,11 @@ void LeptonCamera::start() {
     // Avoid starting the thread if already runs
     if (false == run_thread_) {
         run_thread_ = true;
+        frame_ring_->open();
         grabber_thread_ = std::thread(&LeptonCamera::run, this);
+        if (housekeeping_period_.count() > 0) {
+            housekeeping_thread_ = std::thread(&LeptonCamera::housekeeping, this);
+        }
     }
 }
 
@@ -86,20 +146,33 @@ void LeptonCamera::stop() {
     // Stop the thread only if there is a thread running
     if (true == run_thread_) {
         run_thread_ = false;
+        frame_ring_->close();
         if (grabber_thread_.joinable()) {
             grabber_thread_.join();
         }
+        { std::lock_guard<std::mutex> lock(housekeeping_lock_); }
+        housekeeping_cond_.notify_all();
+        if (housekeeping_thread_.joinable()) {
+            housekeeping_thread_.join();
+        }
+
+        // Wake up the readers waiting for a frame
+        { std::lock_guard<std::mutex> lock(frame_lock_); }
+        frame_cond_.notify_all();
     }
 }
 
 void LeptonCamera::run() {
 
+    configureGrabber();
+
     while (run_thread_) {
 
-        // Get new frame
+        // Get new frame (SPI only, the I2C reads are left to housekeeping).
+        // The read gives up once the camera is stopped, even out of sync
+        LeptonFrame& frame = frames_[frame_write_]->frame;
         try {
-            sensor_temperature_ = leptonI2C_InternalTemp();
-            if (!lePi_.GetFrame(frame_to_write_.data(), FRAME_U16)) {
+            if (!lePi_.GetFrame(frame.pixels.data(), FRAME_U16, &frame.metadata, &run_thread_)) {
                 continue;
             }
         }
@@ -108,55 +181,162 @@ void LeptonCamera::run() {
             continue;
         }
 
-        // Lock resources and swap buffers
-        lock_.lock();
-        std::swap(frame_to_write_, frame_to_read_);
-        has_frame_ = true;
-        lock_.unlock();
+        // With telemetry on, the sensor temperature comes with the frame
+        telemetry_temperature_ = frame.metadata.valid;
+        if (frame.metadata.valid) {
+            sensor_temperature_ = frame.metadata.fpa_temperature;
+        }
+        frame.sensor_temperature = sensor_temperature_;
+        frame.frame_id = frame_id_++;
+        frame.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        // Feed the subscribers (may wait for RING_BLOCK subscribers)
+        frame_ring_->push(frame);
+
+        // Publish the frame, and take the previous middle slot as write slot
+        frame_write_ = frame_middle_.exchange(frame_write_ | kFrameFresh,
+                                              std::memory_order_acq_rel) & kFrameIndex;
+
+        // Notify the readers (the lock orders the publish with their wait).
+        // The eventfd write fails only on counter overflow, when the event is
+        // already pending
+        { std::lock_guard<std::mutex> lock(frame_lock_); }
+        frame_cond_.notify_all();
+        const uint64_t event{1};
+        const ssize_t written{write(frame_event_fd_, &event, sizeof(event))};
+        (void)written;
     }
 }
 
-void LeptonCamera::getFrameU8(std::vector<uint8_t>& frame) {
+void LeptonCamera::configureGrabber() {
 
-    // Resize output frame
-    frame.resize(frame_to_read_.size());
-
-    // Lock resources
-    lock_.lock();
+    // Pin the grabber to one CPU
+    if (options_.cpu_affinity >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options_.cpu_affinity, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            std::cerr << "Unable to pin the grabber thread to CPU "
+                      << options_.cpu_affinity << std::endl;
+        }
+    }
 
-    // Find frame min and max
-    uint16_t minValue = 65535;
-    uint16_t maxValue = 0;
-    for(size_t i = 0; i < frame_to_read_.size(); i++) {
-        if (frame_to_read_[i] > maxValue) {
-            maxValue = frame_to_read_[i];
+    // Real time priority, so the grabber is not preempted mid segment
+    // (requires CAP_SYS_NICE or an RLIMIT_RTPRIO limit)
+    if (options_.realtime_priority > 0) {
+        sched_param param{};
+        param.sched_priority = options_.realtime_priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+            std::cerr << "Unable to set the grabber thread SCHED_FIFO priority "
+                      << options_.realtime_priority << std::endl;
         }
-        if (frame_to_read_[i] < minValue) {
-            minValue = frame_to_read_[i];
+    }
+}
+
+void LeptonCamera::housekeeping() {
+
+    std::unique_lock<std::mutex> lock(housekeeping_lock_);
+    while (run_thread_) {
+
+        // Sample the sensor temperature, unless the telemetry carries it
+        lock.unlock();
+        if (!telemetry_temperature_) {
+            unsigned int temperature{0};
+            if (lePi_.SendCommand(SENSOR_TEMP_K, &temperature)) {
+                sensor_temperature_ = temperature;
+            }
         }
+        lock.lock();
+
+        housekeeping_cond_.wait_for(lock, housekeeping_period_, [this]() {
+            return !run_thread_;
+        });
     }
-    // Scale frame range and copy to output
-    float scale = 255.f / static_cast<float>(maxValue - minValue);
-    for(size_t i = 0; i < frame_to_read_.size(); i++) {
-        frame[i] = static_cast<uint8_t>((frame_to_read_[i] - minValue) * scale);
+}
+
+bool LeptonCamera::hasFrame() const {
+    return (frame_middle_.load(std::memory_order_acquire) & kFrameFresh) != 0;
+}
+
+bool LeptonCamera::waitForFrame(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(frame_lock_);
+    frame_cond_.wait_for(lock, timeout, [this]() {
+        return hasFrame() || !run_thread_;
+    });
+    return hasFrame();
+}
+
+void LeptonCamera::acquireFrame() {
+    if (!hasFrame()) {
+        return;
     }
-    has_frame_ = false;
 
-    // Release resources
-    lock_.unlock();
+    // Released frames go back to the spare slots (new leases are only taken
+    // under the read lock, so a frame with no lease can't get one meanwhile).
+    // The acquire load pairs with the lease release: the lease holders are
+    // done reading the frame before the slot is written again
+    auto released = std::remove_if(parked_frames_.begin(), parked_frames_.end(),
+        [this](uint8_t index) {
+            return frames_[index]->leases.load(std::memory_order_acquire) == 0;
+        });
+    spare_frames_.insert(spare_frames_.end(), released, parked_frames_.end());
+    parked_frames_.erase(released, parked_frames_.end());
+
+    // A leased read slot must not go back to the grabber: park it until its
+    // lease is released, and replace it with a spare slot
+    if (frames_[frame_read_]->leases.load(std::memory_order_acquire) > 0) {
+        if (spare_frames_.empty()) {
+            return; // all slots leased, keep the current frame
+        }
+        parked_frames_.push_back(frame_read_);
+        frame_read_ = spare_frames_.back();
+        spare_frames_.pop_back();
+    }
+
+    frame_read_ = frame_middle_.exchange(frame_read_,
+                                         std::memory_order_acq_rel) & kFrameIndex;
+}
+
+LeptonFrameLease LeptonCamera::leaseFrame() {
+
+    // Take the newest frame (readers only wait for each other)
+    std::lock_guard<std::mutex> lock(read_lock_);
+    acquireFrame();
+    return LeptonFrameLease(frames_[frame_read_]);
+}
+
+void LeptonCamera::getFrameU8(std::vector<uint8_t>& frame) {
+
+    // Resize output frame
+    frame.resize(lepton_config_.width * lepton_config_.height);
+
+    // Take the newest frame (readers only wait for each other)
+    std::lock_guard<std::mutex> lock(read_lock_);
+    acquireFrame();
+    const std::vector<uint16_t>& frame_to_read = frames_[frame_read_]->frame.pixels;
+
+    // Find frame min and max, scale frame range and copy to output
+    uint16_t minValue{0};
+    uint16_t maxValue{0};
+    LeptonMinMax(frame_to_read.data(), frame_to_read.size(), minValue, maxValue);
+    LeptonScale8(frame_to_read.data(), frame_to_read.size(), minValue, maxValue, frame.data());
 }
 
 void LeptonCamera::getFrameU16(std::vector<uint16_t>& frame) {
-    // Lock resources
-    lock_.lock();
 
-    std::copy(frame_to_read_.begin(), frame_to_read_.end(), frame.begin());
-    has_frame_ = false;
+    // Take the newest frame (readers only wait for each other)
+    std::lock_guard<std::mutex> lock(read_lock_);
+    acquireFrame();
+    const std::vector<uint16_t>& frame_to_read = frames_[frame_read_]->frame.pixels;
 
-    // Release resources
-    lock_.unlock();
+    std::copy(frame_to_read.begin(), frame_to_read.end(), frame.begin());
 }
    
+std::shared_ptr<LeptonFrameSubscriber> LeptonCamera::subscribe(LeptonRingPolicy policy) {
+    return std::make_shared<LeptonFrameSubscriber>(frame_ring_, policy);
+}
+
 bool LeptonCamera::sendCommand(LeptonI2CCmd cmd, void* buffer) {
     return lePi_.SendCommand(cmd, buffer);
 }
\ No newline at end of file
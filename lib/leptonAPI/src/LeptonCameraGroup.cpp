@@ -0,0 +1,131 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// LePi
+#include <LeptonCameraGroup.h>
+
+// C/C++
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+
+LeptonCameraGroup::LeptonCameraGroup(const std::vector<std::shared_ptr<LeptonCamera>>& cameras,
+                                     uint32_t max_skew)
+        : cameras_(cameras),
+          max_skew_{max_skew},
+          pending_(cameras.size()),
+          has_pending_(cameras.size(), false) {
+
+    if (cameras_.empty()) {
+        std::cerr << "Camera group without cameras" << std::endl;
+        throw std::runtime_error("Empty camera group.");
+    }
+
+    // Each camera feeds the group through its frame ring
+    for (auto& camera : cameras_) {
+        subscribers_.push_back(camera->subscribe(RING_DROP_OLDEST));
+    }
+    statistics_.skipped_frames.resize(cameras_.size(), 0);
+    statistics_.dropped_frames.resize(cameras_.size(), 0);
+}
+
+LeptonCameraGroup::~LeptonCameraGroup() {
+    stop();
+}
+
+void LeptonCameraGroup::start() {
+    for (auto& camera : cameras_) {
+        camera->start();
+    }
+}
+
+void LeptonCameraGroup::stop() {
+    for (auto& camera : cameras_) {
+        camera->stop();
+    }
+}
+
+bool LeptonCameraGroup::read(std::vector<LeptonFrame>& frames, std::chrono::milliseconds timeout) {
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    uint64_t oldest{0};
+    uint64_t newest{0};
+    while (true) {
+
+        // Next frame of the cameras without a pending one
+        for (size_t i = 0; i < cameras_.size(); ++i) {
+            if (has_pending_[i]) {
+                continue;
+            }
+            const auto remaining = std::max(std::chrono::milliseconds(0),
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()));
+            if (!subscribers_[i]->read(pending_[i], remaining)) {
+                return false;
+            }
+            has_pending_[i] = true;
+        }
+
+        // Skip the frames captured too long before the newest one, they have
+        // no match in the other cameras
+        oldest = pending_[0].timestamp;
+        newest = pending_[0].timestamp;
+        for (const auto& frame : pending_) {
+            oldest = std::min(oldest, frame.timestamp);
+            newest = std::max(newest, frame.timestamp);
+        }
+        if (newest - oldest <= max_skew_) {
+            break;
+        }
+        for (size_t i = 0; i < cameras_.size(); ++i) {
+            if (newest - pending_[i].timestamp > max_skew_) {
+                has_pending_[i] = false;
+                ++statistics_.skipped_frames[i];
+            }
+        }
+    }
+
+    // Hand over the frame set (the frame buffers are swapped, not copied)
+    frames.resize(cameras_.size());
+    for (size_t i = 0; i < cameras_.size(); ++i) {
+        std::swap(frames[i], pending_[i]);
+        has_pending_[i] = false;
+    }
+    ++statistics_.frame_sets;
+    statistics_.skew_sum += newest - oldest;
+    statistics_.max_skew = std::max(statistics_.max_skew, newest - oldest);
+    return true;
+}
+
+LeptonGroupStatistics LeptonCameraGroup::statistics() {
+    for (size_t i = 0; i < cameras_.size(); ++i) {
+        statistics_.dropped_frames[i] = subscribers_[i]->dropped();
+    }
+    return statistics_;
+}
@@ -0,0 +1,194 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <LeptonFrameRing.h>
+
+// C/C++
+#include <algorithm>
+#include <sys/mman.h>
+
+
+//============================================================================
+// Frame ring
+//============================================================================
+
+LeptonFrameRing::LeptonFrameRing(size_t capacity, size_t frame_size)
+        : slots_(std::max<size_t>(capacity, 1)) {
+    for (auto& slot : slots_) {
+        slot.pixels.resize(frame_size);
+    }
+}
+
+LeptonFrameRing::~LeptonFrameRing() {
+    if (locked_) {
+        for (auto& slot : slots_) {
+            munlock(slot.pixels.data(), slot.pixels.size() * sizeof(uint16_t));
+        }
+    }
+}
+
+bool LeptonFrameRing::push(const LeptonFrame& frame) {
+
+    std::unique_lock<std::mutex> lock(lock_);
+
+    // Nobody listens, nothing to store
+    if (cursors_.empty()) {
+        return true;
+    }
+
+    // Wait for the blocking subscribers to release the oldest slot
+    const uint64_t capacity{slots_.size()};
+    not_full_.wait(lock, [&]() {
+        return closed_ || std::none_of(cursors_.begin(), cursors_.end(),
+            [&](const LeptonRingCursor& c) {
+                return c.policy == RING_BLOCK && head_ - c.next >= capacity;
+            });
+    });
+    if (closed_) {
+        return false;
+    }
+
+    // Drop the oldest frame for the subscribers that fell behind
+    for (auto& cursor : cursors_) {
+        if (head_ - cursor.next >= capacity) {
+            const uint64_t oldest{head_ - capacity + 1};
+            cursor.dropped += oldest - cursor.next;
+            cursor.next = oldest;
+        }
+    }
+
+    // Store frame
+    LeptonFrame& slot = slots_[head_ % capacity];
+    std::copy(frame.pixels.begin(), frame.pixels.end(), slot.pixels.begin());
+    slot.frame_id = frame.frame_id;
+    slot.timestamp = frame.timestamp;
+    slot.metadata = frame.metadata;
+    slot.sensor_temperature = frame.sensor_temperature;
+    ++head_;
+
+    lock.unlock();
+    not_empty_.notify_all();
+    return true;
+}
+
+std::list<LeptonRingCursor>::iterator LeptonFrameRing::addCursor(LeptonRingPolicy policy) {
+    std::lock_guard<std::mutex> lock(lock_);
+    LeptonRingCursor cursor;
+    cursor.policy = policy;
+    cursor.next = head_;
+    cursor.dropped = 0;
+    return cursors_.insert(cursors_.end(), cursor);
+}
+
+void LeptonFrameRing::removeCursor(std::list<LeptonRingCursor>::iterator cursor) {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        cursors_.erase(cursor);
+    }
+    not_full_.notify_all();
+}
+
+bool LeptonFrameRing::read(std::list<LeptonRingCursor>::iterator cursor,
+                           LeptonFrame& frame,
+                           std::chrono::milliseconds timeout) {
+
+    std::unique_lock<std::mutex> lock(lock_);
+
+    // Wait for a frame the subscriber did not read yet
+    if (!not_empty_.wait_for(lock, timeout, [&]() {
+            return closed_ || cursor->next < head_; })) {
+        return false;
+    }
+    if (cursor->next >= head_) {
+        return false;
+    }
+
+    // Copy frame and move the cursor
+    const LeptonFrame& slot = slots_[cursor->next % slots_.size()];
+    frame.frame_id = slot.frame_id;
+    frame.timestamp = slot.timestamp;
+    frame.metadata = slot.metadata;
+    frame.sensor_temperature = slot.sensor_temperature;
+    frame.pixels.assign(slot.pixels.begin(), slot.pixels.end());
+    ++cursor->next;
+
+    lock.unlock();
+    not_full_.notify_all();
+    return true;
+}
+
+uint64_t LeptonFrameRing::dropped(std::list<LeptonRingCursor>::iterator cursor) {
+    std::lock_guard<std::mutex> lock(lock_);
+    return cursor->dropped;
+}
+
+void LeptonFrameRing::open() {
+    std::lock_guard<std::mutex> lock(lock_);
+    closed_ = false;
+}
+
+void LeptonFrameRing::close() {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+}
+
+bool LeptonFrameRing::lockMemory() {
+    std::lock_guard<std::mutex> lock(lock_);
+    bool result{true};
+    for (auto& slot : slots_) {
+        result = mlock(slot.pixels.data(), slot.pixels.size() * sizeof(uint16_t)) == 0 && result;
+    }
+    locked_ = true;
+    return result;
+}
+
+//============================================================================
+// Frame subscriber
+//============================================================================
+
+LeptonFrameSubscriber::LeptonFrameSubscriber(std::shared_ptr<LeptonFrameRing> ring,
+                                             LeptonRingPolicy policy)
+        : ring_(ring),
+          cursor_(ring->addCursor(policy)) {
+}
+
+LeptonFrameSubscriber::~LeptonFrameSubscriber() {
+    ring_->removeCursor(cursor_);
+}
+
+bool LeptonFrameSubscriber::read(LeptonFrame& frame, std::chrono::milliseconds timeout) {
+    return ring_->read(cursor_, frame, timeout);
+}
+
+uint64_t LeptonFrameSubscriber::dropped() {
+    return ring_->dropped(cursor_);
+}
@@ -0,0 +1,411 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// LePi
+#include <LeptonRecorder.h>
+
+// C/C++
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// Max wait for a frame, before checking the recorder was stopped
+constexpr std::chrono::milliseconds kRecorderPollTimeout{100};
+
+// Page size the file regions are aligned to
+constexpr uint64_t kRecordAlignment{4096};
+
+static uint64_t AlignUp(uint64_t size) {
+    return (size + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+}
+
+
+std::string LeptonRecordSegmentPath(const std::string& path, uint32_t segment) {
+    char number[16];
+    snprintf(number, sizeof(number), "_%04u", segment);
+    return path + number + kRecordExtension;
+}
+
+
+//============================================================================
+// Recorder
+//============================================================================
+
+LeptonRecorder::LeptonRecorder(LeptonCamera& camera, const LeptonRecorderOptions& options)
+        : camera_(camera),
+          options_(options),
+          recorder_thread_(),
+          run_thread_{false},
+          segment_fd_{-1},
+          segment_{nullptr},
+          segment_size_{0},
+          segment_number_{0},
+          header_{nullptr},
+          index_{nullptr},
+          written_back_{0},
+          frames_{0},
+          segments_{0},
+          dropped_{0},
+          failed_{false} {
+    options_.segment_frames = std::max<uint32_t>(options_.segment_frames, 1);
+}
+
+LeptonRecorder::~LeptonRecorder() {
+    stop();
+}
+
+void LeptonRecorder::start() {
+
+    // Avoid starting the thread if already runs
+    if (false == run_thread_) {
+        if (recorder_thread_.joinable()) {
+            recorder_thread_.join();    // recorder stopped on a storage error
+        }
+        frames_ = 0;
+        segments_ = 0;
+        dropped_ = 0;
+        failed_ = false;
+        segment_number_ = 0;
+        subscriber_ = camera_.subscribe(RING_DROP_OLDEST);
+        run_thread_ = true;
+        recorder_thread_ = std::thread(&LeptonRecorder::run, this);
+    }
+}
+
+void LeptonRecorder::stop() {
+    run_thread_ = false;
+    if (recorder_thread_.joinable()) {
+        recorder_thread_.join();
+    }
+    subscriber_.reset();
+}
+
+LeptonRecorderStatistics LeptonRecorder::statistics() const {
+    LeptonRecorderStatistics stats;
+    stats.frames = frames_;
+    stats.dropped = dropped_;
+    stats.segments = segments_;
+    stats.bytes = stats.frames * camera_.width() * camera_.height() * sizeof(uint16_t);
+    stats.failed = failed_;
+    return stats;
+}
+
+std::string LeptonRecorder::segmentPath(uint32_t segment) const {
+    return LeptonRecordSegmentPath(options_.path, segment);
+}
+
+void LeptonRecorder::run() {
+
+    LeptonFrame frame;
+    uint64_t last_dropped{0};
+    while (run_thread_) {
+        if (!subscriber_->read(frame, kRecorderPollTimeout)) {
+            continue;
+        }
+
+        // Frames the ring overwrote before the recorder read them
+        const uint64_t ring_dropped{subscriber_->dropped()};
+        dropped_ += ring_dropped - last_dropped;
+        last_dropped = ring_dropped;
+
+        // Slot of the frame, in a new segment once the current one is full
+        uint64_t slot{header_ ? frame.frame_id - header_->first_frame_id : 0};
+        if (!header_ || frame.frame_id < header_->first_frame_id ||
+            slot >= header_->capacity) {
+            closeSegment();
+            if (!openSegment(frame.frame_id)) {
+                failed_ = true;
+                run_thread_ = false;
+                break;
+            }
+            slot = 0;
+        }
+        writeFrame(frame, slot);
+    }
+    closeSegment();
+}
+
+bool LeptonRecorder::openSegment(uint64_t first_frame_id) {
+
+    // Segment layout
+    const uint64_t capacity{options_.segment_frames};
+    const uint64_t frame_size{static_cast<uint64_t>(camera_.width()) * camera_.height() *
+                              sizeof(uint16_t)};
+    const uint64_t index_offset{kRecordHeaderSize};
+    const uint64_t data_offset{AlignUp(index_offset + capacity * sizeof(LeptonRecordEntry))};
+    const uint64_t size{data_offset + capacity * frame_size};
+
+    // Preallocate the file, so recording never runs out of space midway and
+    // the frames are laid out contiguously on the card
+    const std::string path{segmentPath(segment_number_)};
+    segment_fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment_fd_ < 0) {
+        std::cerr << "Unable to create recording segment " << path << ": "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+    const int rc{posix_fallocate(segment_fd_, 0, static_cast<off_t>(size))};
+    if (rc != 0) {
+        std::cerr << "Unable to allocate recording segment " << path << ": "
+                  << strerror(rc) << std::endl;
+        close(segment_fd_);
+        segment_fd_ = -1;
+        return false;
+    }
+    void* segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd_, 0);
+    if (segment == MAP_FAILED) {
+        std::cerr << "Unable to map recording segment " << path << ": "
+                  << strerror(errno) << std::endl;
+        close(segment_fd_);
+        segment_fd_ = -1;
+        return false;
+    }
+    madvise(segment, size, MADV_SEQUENTIAL);
+    segment_ = static_cast<uint8_t*>(segment);
+    segment_size_ = size;
+    written_back_ = 0;
+
+    // Header
+    header_ = reinterpret_cast<LeptonRecordHeader*>(segment_);
+    index_ = reinterpret_cast<LeptonRecordEntry*>(segment_ + index_offset);
+    memcpy(header_->magic, kRecordMagic, sizeof(header_->magic));
+    header_->version = kRecordVersion;
+    header_->byte_order = kRecordByteOrder;
+    header_->width = camera_.width();
+    header_->height = camera_.height();
+    header_->capacity = static_cast<uint32_t>(capacity);
+    header_->segment = segment_number_;
+    header_->index_offset = index_offset;
+    header_->data_offset = data_offset;
+    header_->frame_size = frame_size;
+    header_->first_frame_id = first_frame_id;
+    header_->count = 0;
+
+    ++segment_number_;
+    ++segments_;
+    return true;
+}
+
+void LeptonRecorder::closeSegment() {
+    if (!segment_) {
+        return;
+    }
+
+    // Trim the unused frame slots, and flush the segment
+    const uint64_t count{header_->count};
+    const off_t size{static_cast<off_t>(header_->data_offset + count * header_->frame_size)};
+    msync(segment_, segment_size_, MS_SYNC);
+    munmap(segment_, segment_size_);
+    if (ftruncate(segment_fd_, size) != 0) {
+        std::cerr << "Unable to trim recording segment: " << strerror(errno) << std::endl;
+    }
+    close(segment_fd_);
+    segment_fd_ = -1;
+    segment_ = nullptr;
+    header_ = nullptr;
+    index_ = nullptr;
+}
+
+void LeptonRecorder::writeFrame(const LeptonFrame& frame, uint64_t slot) {
+
+    // Pixels, then index entry
+    memcpy(segment_ + header_->data_offset + slot * header_->frame_size,
+           frame.pixels.data(), header_->frame_size);
+    LeptonRecordEntry& entry = index_[slot];
+    entry.frame_id = frame.frame_id;
+    entry.timestamp = frame.timestamp;
+    entry.sensor_temperature = frame.sensor_temperature;
+    entry.frame_counter = frame.metadata.frame_counter;
+    entry.time_counter = frame.metadata.time_counter;
+    entry.fpa_temperature = frame.metadata.fpa_temperature;
+    entry.housing_temperature = frame.metadata.housing_temperature;
+    entry.ffc_state = static_cast<uint8_t>(frame.metadata.ffc_state);
+    entry.flags = kRecordValid |
+                  (frame.metadata.valid ? kRecordTelemetry : 0) |
+                  (frame.metadata.ffc_desired ? kRecordFFCDesired : 0);
+
+    // Publish the frame to the readers of the segment
+    __atomic_store_n(&header_->count, slot + 1, __ATOMIC_RELEASE);
+    ++frames_;
+
+    // Start writing the new frames out, instead of letting the dirty pages
+    // pile up and go out in one long burst
+    const uint64_t count{slot + 1};
+    if (options_.writeback_frames > 0 && count - written_back_ >= options_.writeback_frames) {
+        const uint64_t offset{header_->data_offset + written_back_ * header_->frame_size};
+        sync_file_range(segment_fd_, static_cast<off_t>(offset),
+                        static_cast<off_t>((count - written_back_) * header_->frame_size),
+                        SYNC_FILE_RANGE_WRITE);
+        written_back_ = count;
+    }
+}
+
+
+//============================================================================
+// Reader
+//============================================================================
+
+LeptonRecordReader::LeptonRecordReader(const std::string& path)
+        : fd_{-1},
+          data_{nullptr},
+          data_size_{0},
+          header_{nullptr},
+          index_{nullptr} {
+
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat file_stat;
+    if (fd_ < 0 || fstat(fd_, &file_stat) != 0) {
+        std::cerr << "Unable to open recording " << path << ": " << strerror(errno) << std::endl;
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        throw std::runtime_error("Recording open failed.");
+    }
+    data_size_ = static_cast<size_t>(file_stat.st_size);
+    void* data = data_size_ >= kRecordHeaderSize ?
+                 mmap(nullptr, data_size_, PROT_READ, MAP_SHARED, fd_, 0) : MAP_FAILED;
+    if (data == MAP_FAILED) {
+        std::cerr << "Unable to map recording " << path << std::endl;
+        close(fd_);
+        throw std::runtime_error("Recording open failed.");
+    }
+    data_ = static_cast<const uint8_t*>(data);
+    header_ = reinterpret_cast<const LeptonRecordHeader*>(data_);
+
+    // Check the format, and that the index fits the file
+    const uint64_t index_end{header_->index_offset +
+                             static_cast<uint64_t>(header_->capacity) * sizeof(LeptonRecordEntry)};
+    if (memcmp(header_->magic, kRecordMagic, sizeof(kRecordMagic)) != 0 ||
+        header_->version != kRecordVersion || header_->byte_order != kRecordByteOrder ||
+        header_->frame_size != static_cast<uint64_t>(header_->width) * header_->height * sizeof(uint16_t) ||
+        index_end > header_->data_offset || header_->data_offset > data_size_) {
+        std::cerr << "Unsupported recording " << path << std::endl;
+        munmap(const_cast<uint8_t*>(data_), data_size_);
+        close(fd_);
+        throw std::runtime_error("Recording format error.");
+    }
+    index_ = reinterpret_cast<const LeptonRecordEntry*>(data_ + header_->index_offset);
+}
+
+LeptonRecordReader::~LeptonRecordReader() {
+    munmap(const_cast<uint8_t*>(data_), data_size_);
+    close(fd_);
+}
+
+size_t LeptonRecordReader::size() const {
+
+    // Frames written, and mapped (the file may have been trimmed meanwhile)
+    const uint64_t count{__atomic_load_n(&header_->count, __ATOMIC_ACQUIRE)};
+    const uint64_t mapped{(data_size_ - header_->data_offset) / header_->frame_size};
+    return static_cast<size_t>(std::min(count, mapped));
+}
+
+const uint16_t* LeptonRecordReader::pixels(size_t slot) const {
+    return reinterpret_cast<const uint16_t*>(data_ + header_->data_offset +
+                                             slot * header_->frame_size);
+}
+
+bool LeptonRecordReader::read(size_t slot, LeptonFrame& frame) const {
+    if (slot >= size() || !(index_[slot].flags & kRecordValid)) {
+        return false;
+    }
+    const LeptonRecordEntry& entry = index_[slot];
+    const size_t num_pixels{static_cast<size_t>(header_->width) * header_->height};
+    frame.pixels.resize(num_pixels);
+    memcpy(frame.pixels.data(), pixels(slot), header_->frame_size);
+    frame.frame_id = entry.frame_id;
+    frame.timestamp = entry.timestamp;
+    frame.sensor_temperature = entry.sensor_temperature;
+    frame.metadata.valid = (entry.flags & kRecordTelemetry) != 0;
+    frame.metadata.frame_counter = entry.frame_counter;
+    frame.metadata.time_counter = entry.time_counter;
+    frame.metadata.fpa_temperature = entry.fpa_temperature;
+    frame.metadata.housing_temperature = entry.housing_temperature;
+    frame.metadata.ffc_state = static_cast<LeptonFFCState>(entry.ffc_state);
+    frame.metadata.ffc_desired = (entry.flags & kRecordFFCDesired) != 0;
+    return true;
+}
+
+int64_t LeptonRecordReader::findFrameId(uint64_t frame_id) const {
+    if (frame_id < header_->first_frame_id) {
+        return -1;
+    }
+    const uint64_t slot{frame_id - header_->first_frame_id};
+    if (slot >= size() || !(index_[slot].flags & kRecordValid)) {
+        return -1;
+    }
+    return static_cast<int64_t>(slot);
+}
+
+int64_t LeptonRecordReader::findTimestamp(uint64_t timestamp) const {
+    const int64_t count{static_cast<int64_t>(size())};
+    if (count == 0) {
+        return -1;
+    }
+
+    // The first and last slots always hold a frame
+    const uint64_t first{index_[0].timestamp};
+    const uint64_t last{index_[count - 1].timestamp};
+    if (timestamp > last) {
+        return -1;
+    }
+    if (timestamp <= first) {
+        return 0;
+    }
+
+    // Interpolated guess
+    int64_t slot{static_cast<int64_t>(static_cast<double>(timestamp - first) /
+                                      static_cast<double>(last - first) * (count - 1))};
+    slot = std::min(std::max(slot, int64_t(0)), count - 1);
+
+    // Back to the first frame at or after the time, then forward past the
+    // empty slots and the earlier frames
+    while (slot > 0) {
+        int64_t previous{slot - 1};
+        while (previous > 0 && !(index_[previous].flags & kRecordValid)) {
+            --previous;
+        }
+        if (index_[previous].timestamp < timestamp) {
+            break;
+        }
+        slot = previous;
+    }
+    while (slot < count && (!(index_[slot].flags & kRecordValid) ||
+                            index_[slot].timestamp < timestamp)) {
+        ++slot;
+    }
+    return slot < count ? slot : -1;
+}
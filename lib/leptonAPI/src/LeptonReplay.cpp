@@ -0,0 +1,176 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// LePi
+#include <LeptonReplay.h>
+
+// C/C++
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+
+// Unique frame period of the simulated sensor, in microseconds
+constexpr uint64_t kReplayFramePeriod{kLeptonFramePeriod * 3ull};
+
+
+LeptonReplay::LeptonReplay(const LeptonReplayConfig& config)
+        : LeptonSimulator(SimulatorConfig(config)),
+          config_(config) {
+
+    // Open all the recording segments
+    for (uint32_t segment = 0; ; ++segment) {
+        const std::string path{LeptonRecordSegmentPath(config_.path, segment)};
+        if (access(path.c_str(), F_OK) != 0) {
+            break;
+        }
+        segments_.emplace_back(new LeptonRecordReader(path));
+        const LeptonRecordReader& reader = *segments_.back();
+        if (reader.width() != segments_.front()->width() ||
+            reader.height() != segments_.front()->height()) {
+            std::cerr << "Recording segment " << path << " frame size differs." << std::endl;
+            throw std::runtime_error("Replay open failed.");
+        }
+        for (size_t slot = 0; slot < reader.size(); ++slot) {
+            if (reader.entry(slot).flags & kRecordValid) {
+                ++recorded_frames_;
+            }
+        }
+    }
+
+    // A segment always starts with a frame
+    if (recorded_frames_ == 0 || segments_.front()->size() == 0) {
+        std::cerr << "Recording " << config_.path << " has no frames." << std::endl;
+        throw std::runtime_error("Replay open failed.");
+    }
+    first_timestamp_ = segments_.front()->entry(0).timestamp;
+}
+
+LeptonSimulatorConfig LeptonReplay::SimulatorConfig(const LeptonReplayConfig& config) {
+
+    // Sensor type from the recorded frame size
+    LeptonRecordReader reader(LeptonRecordSegmentPath(config.path, 0));
+    LeptonSimulatorConfig sim_config;
+    if (reader.width() == LeptonCameraConfig(LEPTON2).width &&
+        reader.height() == LeptonCameraConfig(LEPTON2).height) {
+        sim_config.type = LEPTON2;
+    }
+    else if (reader.width() == LeptonCameraConfig(LEPTON3).width &&
+             reader.height() == LeptonCameraConfig(LEPTON3).height) {
+        sim_config.type = LEPTON3;
+    }
+    else {
+        std::cerr << "Recording " << config.path << " frame size is not a Lepton 2/3 one." << std::endl;
+        throw std::runtime_error("Replay open failed.");
+    }
+    sim_config.throttle = config.throttle;
+    sim_config.speed = config.speed;
+    return sim_config;
+}
+
+unsigned int LeptonReplay::InternalTemp() {
+    const unsigned int temperature{LeptonSimulator::InternalTemp()};
+    return temperature > 0 ? temperature_.load() : 0;
+}
+
+void LeptonReplay::RenderScene(uint64_t frame_number, uint16_t* scene) {
+
+    // First frame of the replay
+    if (!started_) {
+        started_ = true;
+        loop_start_ = frame_number;
+        ++frames_replayed_;
+    }
+    else {
+        // Last recorded frame due at this time on the sensor timeline (every
+        // unique frame takes the next recorded one, when unthrottled). The
+        // recorded frames fall on the unique frame starts (the first one is at
+        // 0), so the frames due within half a period are taken as well: the
+        // capture time jitter does not move them to the next unique frame
+        const uint64_t time{(frame_number - loop_start_) * kReplayFramePeriod};
+        const uint64_t due{time + kReplayFramePeriod / 2};
+        while (true) {
+            size_t segment{segment_};
+            size_t slot{slot_};
+            if (!NextFrame(segment, slot)) {
+                // End of the recording, start over once the last frame was shown
+                // for a frame period
+                const bool shown{!config_.throttle ||
+                                 time >= FrameTime(segment_, slot_) + kReplayFramePeriod};
+                if (shown && config_.loop) {
+                    segment_ = 0;
+                    slot_ = 0;
+                    loop_start_ = frame_number;
+                    ++loops_;
+                    ++frames_replayed_;
+                }
+                else if (shown) {
+                    finished_ = true;
+                }
+                break;
+            }
+            if (config_.throttle && FrameTime(segment, slot) > due) {
+                break;
+            }
+            segment_ = segment;
+            slot_ = slot;
+            ++frames_replayed_;
+            if (!config_.throttle) {
+                break;
+            }
+        }
+    }
+
+    // Recorded frame pixels, and sensor temperature
+    const LeptonRecordReader& reader = *segments_[segment_];
+    memcpy(scene, reader.pixels(slot_), reader.header().frame_size);
+    temperature_ = static_cast<unsigned int>(reader.entry(slot_).sensor_temperature);
+}
+
+bool LeptonReplay::NextFrame(size_t& segment, size_t& slot) const {
+    size_t next_segment{segment};
+    size_t next_slot{slot + 1};
+    while (next_segment < segments_.size()) {
+        const LeptonRecordReader& reader = *segments_[next_segment];
+        for (; next_slot < reader.size(); ++next_slot) {
+            if (reader.entry(next_slot).flags & kRecordValid) {
+                segment = next_segment;
+                slot = next_slot;
+                return true;
+            }
+        }
+        ++next_segment;
+        next_slot = 0;
+    }
+    return false;
+}
+
+uint64_t LeptonReplay::FrameTime(size_t segment, size_t slot) const {
+    return segments_[segment]->entry(slot).timestamp - first_timestamp_;
+}
@@ -0,0 +1,374 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <LeptonCommon.h>
+#include <LeptonSimulator.h>
+#include <crc16.h>
+
+// C/C++
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+
+// VoSPI frame period, and number of VoSPI frames per unique sensor frame
+constexpr uint64_t kFramePeriodNs{kLeptonFramePeriod * 1000ull};
+constexpr uint64_t kFramesPerUniqueFrame{3};
+
+// Max lead of the SPI reads over the wall clock before the reader sleeps
+constexpr uint64_t kBusSlackNs{500000};
+
+
+LeptonSimulator::LeptonSimulator(const LeptonSimulatorConfig& config)
+        : config_(config),
+          camera_config_(config.type),
+          epoch_(std::chrono::steady_clock::now()),
+          rng_(config.seed) {
+
+    if (config_.speed <= 0.0) {
+        config_.speed = 1.0;
+    }
+    scene_.resize(camera_config_.width * camera_config_.height);
+}
+
+//============================================================================
+// SPI
+//============================================================================
+
+void LeptonSimulator::OpenSPI(int /*spi_port*/, uint32_t spi_speed) {
+    // Time needed to clock one packet out of the sensor
+    packet_time_ns_ = camera_config_.packet_size * 8ull * 1000000000ull / spi_speed;
+    spi_open_ = true;
+    ++spi_open_count_;
+}
+
+void LeptonSimulator::CloseSPI(int /*spi_port*/) {
+    spi_open_ = false;
+}
+
+void LeptonSimulator::ReadSPI(uint8_t* buffer, size_t size) {
+
+    const size_t packet_size{camera_config_.packet_size};
+    const size_t num_packets{size / packet_size};
+
+    // Port closed, nothing to clock out
+    if (!spi_open_) {
+        memset(buffer, 0, size);
+        return;
+    }
+
+    // Clock out the packets, each one at its own time on the sensor timeline.
+    // Throttled, the transfer follows the previous one on the bus while the
+    // reader keeps up, so the bus time does not depend on the sleep accuracy
+    const uint64_t now{Now()};
+    const uint64_t start{config_.throttle ? std::max(now, bus_time_ns_) : now};
+    for (size_t i = 0; i < num_packets; ++i) {
+        UpdatePeriod(start + i * packet_time_ns_);
+        WritePacket(buffer + i * packet_size);
+    }
+    packets_read_ += num_packets;
+    ++spi_transfers_;
+
+    // Transfer ends once all the packets went over the bus
+    const uint64_t end{start + num_packets * packet_time_ns_};
+    if (config_.throttle) {
+        bus_time_ns_ = end;
+        if (end - now > static_cast<uint64_t>(kBusSlackNs * config_.speed)) {
+            SleepUntil(end);
+        }
+    }
+    else {
+        clock_ns_ = end;
+    }
+}
+
+//============================================================================
+// I2C
+//============================================================================
+
+void LeptonSimulator::ConnectI2C() {
+    i2c_open_ = true;
+}
+
+void LeptonSimulator::DisconnectI2C() {
+    i2c_open_ = false;
+}
+
+bool LeptonSimulator::ShutterOpen() {
+    return i2c_open_;
+}
+
+bool LeptonSimulator::ShutterClose() {
+    return i2c_open_;
+}
+
+bool LeptonSimulator::FFC() {
+    return i2c_open_;
+}
+
+bool LeptonSimulator::Reboot() {
+    if (i2c_open_) {
+        ++reboot_count_;
+    }
+    return i2c_open_;
+}
+
+unsigned int LeptonSimulator::InternalTemp() {
+    if (config_.throttle && config_.i2c_time > 0) {
+        usleep(config_.i2c_time);
+    }
+    return i2c_open_ ? config_.temperature : 0;
+}
+
+unsigned int LeptonSimulator::SensorNumber() {
+    if (!i2c_open_) {
+        return 0;
+    }
+    return config_.type == LEPTON2 ? 2 : 3;
+}
+
+//============================================================================
+// VSYNC
+//============================================================================
+
+bool LeptonSimulator::EnableVsync(unsigned int /*gpio*/, int /*phase_delay*/) {
+    vsync_ = i2c_open_.load();
+    return vsync_;
+}
+
+void LeptonSimulator::DisableVsync() {
+    vsync_ = false;
+}
+
+bool LeptonSimulator::WaitVsync(uint32_t timeout) {
+
+    if (!vsync_) {
+        Wait(timeout);
+        return false;
+    }
+
+    // Next segment (frame for Lepton 2) start on the sensor timeline
+    const uint64_t segment_period{kFramePeriodNs / camera_config_.segments_per_frame};
+    const uint64_t now{Now()};
+    const uint64_t edge{(now / segment_period + 1) * segment_period};
+    if (edge - now > timeout * 1000ull) {
+        Wait(timeout);
+        return false;
+    }
+
+    if (config_.throttle) {
+        SleepUntil(edge);
+    }
+    else {
+        clock_ns_ = edge;
+    }
+    ++vsync_edges_;
+    return true;
+}
+
+//============================================================================
+// Telemetry
+//============================================================================
+
+bool LeptonSimulator::SetTelemetry(LeptonTelemetryMode mode) {
+    if (!i2c_open_) {
+        return false;
+    }
+    camera_config_ = LeptonCameraConfig(config_.type, mode);
+    packet_index_ = 0;
+    return true;
+}
+
+//============================================================================
+// Timing
+//============================================================================
+
+void LeptonSimulator::Wait(uint32_t microseconds) {
+    if (config_.throttle) {
+        usleep(static_cast<useconds_t>(microseconds / config_.speed));
+    }
+    else {
+        clock_ns_ += microseconds * 1000ull;
+    }
+}
+
+uint64_t LeptonSimulator::Now() const {
+    if (config_.throttle) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch_).count() * config_.speed);
+    }
+    return clock_ns_;
+}
+
+void LeptonSimulator::SleepUntil(uint64_t time_ns) const {
+    std::this_thread::sleep_until(epoch_ + std::chrono::nanoseconds(
+        static_cast<uint64_t>(time_ns / config_.speed)));
+}
+
+//============================================================================
+// VoSPI stream
+//============================================================================
+
+void LeptonSimulator::UpdatePeriod(uint64_t time_ns) {
+
+    // Still in the same VoSPI frame period
+    const uint64_t period{time_ns / kFramePeriodNs};
+    if (period == period_) {
+        return;
+    }
+
+    // New frame available, anything not read from the previous one is lost
+    period_ = period;
+    packet_index_ = 0;
+    const uint64_t frame_number{period / kFramesPerUniqueFrame};
+    if (frame_number != scene_frame_) {
+        RenderScene(frame_number, scene_.data());
+        scene_frame_ = frame_number;
+    }
+}
+
+void LeptonSimulator::RenderScene(uint64_t frame_number, uint16_t* scene) {
+
+    // Background gradient, plus a warm object moving across the field of view
+    const int width{camera_config_.width};
+    const int height{camera_config_.height};
+    const int radius{height / 6};
+    const int cx{static_cast<int>(frame_number % width)};
+    const int cy{static_cast<int>(height / 2 + (frame_number / width) % (height / 2)) - height / 4};
+
+    // Sensor noise (deterministic for a given frame)
+    uint32_t noise{static_cast<uint32_t>(frame_number) * 2654435761u + 1u};
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int value{7900 + 4 * x + 2 * y};
+            const int dx{x - cx};
+            const int dy{y - cy};
+            if (dx * dx + dy * dy < radius * radius) {
+                value += 600;
+            }
+            noise = noise * 1664525u + 1013904223u;
+            value += (noise >> 28) & 0x07;
+            scene[y * width + x] = static_cast<uint16_t>(value);
+        }
+    }
+}
+
+void LeptonSimulator::WritePacket(uint8_t* packet) {
+
+    const uint32_t packet_size{camera_config_.packet_size};
+    const uint32_t packets_per_frame{static_cast<uint32_t>(camera_config_.packets_per_segment) *
+                                     camera_config_.segments_per_frame};
+
+    // Desync injection, a data packet is lost on the bus
+    if (packet_index_ < packets_per_frame && config_.desync_rate > 0.0 &&
+        uniform_(rng_) < config_.desync_rate) {
+        ++packet_index_;
+        ++desyncs_injected_;
+    }
+
+    // Frame already clocked out, send discard packets until the next one
+    if (packet_index_ >= packets_per_frame) {
+        memset(packet, 0, packet_size);
+        packet[0] = 0x0F;
+        packet[1] = 0xFF;
+        ++discard_packets_;
+        return;
+    }
+
+    // Packet header: ID (segment number + packet number)
+    const uint32_t segment{packet_index_ / camera_config_.packets_per_segment};
+    const uint32_t number{packet_index_ % camera_config_.packets_per_segment};
+    uint16_t id{static_cast<uint16_t>(number)};
+    if (camera_config_.segments_per_frame > 1 &&
+        number == camera_config_.segment_number_packet_index) {
+        // Lepton 3 sends valid segments only for 1 out of 3 frames
+        const bool valid_frame{period_ % kFramesPerUniqueFrame == 0};
+        id |= static_cast<uint16_t>((valid_frame ? segment + 1 : 0) << 12);
+    }
+    packet[0] = static_cast<uint8_t>(id >> 8);
+    packet[1] = static_cast<uint8_t>(id & 0xFF);
+    packet[2] = 0;
+    packet[3] = 0;
+
+    // Packet payload: telemetry row, or big endian pixels
+    const uint32_t telemetry_packet{packet_index_ - camera_config_.telemetry_packet_index};
+    if (packet_index_ >= camera_config_.telemetry_packet_index &&
+        telemetry_packet < camera_config_.telemetry_packets) {
+        WriteTelemetry(packet + 4, telemetry_packet);
+    }
+    else {
+        const uint32_t pixels_per_packet{(packet_size - 4u) / 2u};
+        const uint32_t image_packet{packet_index_ - camera_config_.image_packet_index};
+        const uint16_t* pixels{scene_.data() + image_packet * pixels_per_packet};
+        for (uint32_t i = 0; i < pixels_per_packet; ++i) {
+            packet[4 + 2 * i] = static_cast<uint8_t>(pixels[i] >> 8);
+            packet[5 + 2 * i] = static_cast<uint8_t>(pixels[i] & 0xFF);
+        }
+    }
+
+    // Packet CRC, computed with the segment number and CRC fields cleared
+    packet[0] &= 0x0F;
+    CRC16 crc{CalcCRC16Bytes(packet_size, reinterpret_cast<char *>(packet))};
+    packet[0] = static_cast<uint8_t>(id >> 8);
+    packet[2] = static_cast<uint8_t>(crc >> 8);
+    packet[3] = static_cast<uint8_t>(crc & 0xFF);
+
+    ++packet_index_;
+}
+
+void LeptonSimulator::WriteTelemetry(uint8_t* payload, uint32_t telemetry_packet) {
+
+    const uint32_t payload_size{camera_config_.packet_size - 4u};
+    memset(payload, 0, payload_size);
+    if (telemetry_packet != 0) {
+        return;
+    }
+
+    // Row A words are big endian, 32 bit values are sent LSW first
+    auto word = [payload](uint32_t index, uint16_t value) {
+        payload[2 * index] = static_cast<uint8_t>(value >> 8);
+        payload[2 * index + 1] = static_cast<uint8_t>(value & 0xFF);
+    };
+    auto dword = [&word](uint32_t index, uint32_t value) {
+        word(index, static_cast<uint16_t>(value & 0xFFFF));
+        word(index + 1, static_cast<uint16_t>(value >> 16));
+    };
+
+    // The sensor counts the frames at 27 Hz, the repeated frames keep the
+    // counters of the unique frame they repeat
+    const uint64_t sensor_frame{scene_frame_ * kFramesPerUniqueFrame};
+    const uint32_t time_ms{static_cast<uint32_t>(sensor_frame * kFramePeriodNs / 1000000ull)};
+    word(0, 14);    // telemetry revision
+    dword(1, time_ms);
+    dword(3, static_cast<uint32_t>(FFC_COMPLETE) << 4);
+    dword(20, static_cast<uint32_t>(sensor_frame));
+    word(24, static_cast<uint16_t>(config_.temperature));
+    word(26, static_cast<uint16_t>(config_.temperature - 200));
+}
@@ -0,0 +1,73 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <LeptonStatistics.h>
+
+
+LeptonCounters::LeptonCounters() {
+    Reset();
+}
+
+void LeptonCounters::AddLatency(uint64_t microseconds) {
+    size_t bucket{0};
+    while (bucket < kLatencyBuckets - 1 && microseconds > kLatencyBucketBounds[bucket]) {
+        ++bucket;
+    }
+    Increment(latency[bucket]);
+    Increment(latency_sum, microseconds);
+}
+
+LeptonStatistics LeptonCounters::Snapshot() const {
+    LeptonStatistics stats;
+    stats.frames = frames.load(std::memory_order_relaxed);
+    stats.discard_packets = discard_packets.load(std::memory_order_relaxed);
+    stats.packet_mismatches = packet_mismatches.load(std::memory_order_relaxed);
+    stats.segment_mismatches = segment_mismatches.load(std::memory_order_relaxed);
+    stats.spi_resets = spi_resets.load(std::memory_order_relaxed);
+    stats.reboots = reboots.load(std::memory_order_relaxed);
+    stats.duplicate_frames = duplicate_frames.load(std::memory_order_relaxed);
+    stats.latency_sum = latency_sum.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kLatencyBuckets; ++i) {
+        stats.latency[i] = latency[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void LeptonCounters::Reset() {
+    frames = 0;
+    discard_packets = 0;
+    packet_mismatches = 0;
+    segment_mismatches = 0;
+    spi_resets = 0;
+    reboots = 0;
+    duplicate_frames = 0;
+    latency_sum = 0;
+    for (auto& bucket : latency) {
+        bucket = 0;
+    }
+}
@@ -0,0 +1,195 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <LeptonTransport.h>
+#include <LeptonUtils.h>
+
+// C/C++
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+
+// spidev buffer size, limits the number of bytes in one SPI message
+const char kSpidevBufsizPath[]{"/sys/module/spidev/parameters/bufsiz"};
+
+
+//============================================================================
+// SPI
+//============================================================================
+
+void LeptonHardwareTransport::OpenSPI(int spi_port, uint32_t spi_speed) {
+    spi_fd_ = leptonSPI_OpenPort(spi_port, spi_speed);
+    spi_speed_ = spi_speed;
+
+    // Read spidev transfer limit (default 4096 bytes)
+    std::ifstream bufsiz(kSpidevBufsizPath);
+    size_t size{0};
+    if (bufsiz >> size && size > 0) {
+        max_transfer_size_ = size;
+    }
+}
+
+void LeptonHardwareTransport::CloseSPI(int spi_port) {
+    leptonSPI_ClosePort(spi_port, spi_fd_);
+    spi_fd_ = -1;
+}
+
+void LeptonHardwareTransport::ReadSPI(uint8_t* buffer, size_t size) {
+    read(spi_fd_, buffer, size);
+}
+
+void LeptonHardwareTransport::ReadSPIPackets(uint8_t* buffer,
+                                             uint16_t num_packets,
+                                             uint16_t packet_size) {
+
+    // One transfer descriptor per packet, all submitted in a single SPI message
+    // (chip select stays asserted between packets)
+    if (transfers_.size() < num_packets) {
+        transfers_.resize(num_packets);
+    }
+    memset(transfers_.data(), 0, num_packets * sizeof(spi_ioc_transfer));
+    for (uint16_t i = 0; i < num_packets; ++i) {
+        transfers_[i].rx_buf = reinterpret_cast<unsigned long>(buffer + i * packet_size);
+        transfers_[i].len = packet_size;
+        transfers_[i].speed_hz = spi_speed_;
+        transfers_[i].bits_per_word = 8;
+    }
+
+    if (ioctl(spi_fd_, SPI_IOC_MESSAGE(num_packets), transfers_.data()) < 0) {
+        std::cerr << "SPI bulk transfer failed...ioctl fail" << std::endl;
+    }
+}
+
+size_t LeptonHardwareTransport::MaxTransferSize() const {
+    return max_transfer_size_;
+}
+
+//============================================================================
+// I2C
+//============================================================================
+
+void LeptonHardwareTransport::ConnectI2C() {
+    leptonI2C_connect(i2c_port_, i2c_port_id_);
+}
+
+void LeptonHardwareTransport::DisconnectI2C() {
+    leptonI2C_disconnect(i2c_port_);
+}
+
+bool LeptonHardwareTransport::ShutterOpen() {
+    return leptonI2C_ShutterOpen(i2c_port_);
+}
+
+bool LeptonHardwareTransport::ShutterClose() {
+    return leptonI2C_ShutterClose(i2c_port_);
+}
+
+bool LeptonHardwareTransport::FFC() {
+    return leptonI2C_FFC(i2c_port_);
+}
+
+bool LeptonHardwareTransport::Reboot() {
+    return leptonI2C_Reboot(i2c_port_);
+}
+
+unsigned int LeptonHardwareTransport::InternalTemp() {
+    return leptonI2C_InternalTemp(i2c_port_);
+}
+
+unsigned int LeptonHardwareTransport::SensorNumber() {
+    return leptonI2C_SensorNumber(i2c_port_);
+}
+
+//============================================================================
+// VSYNC
+//============================================================================
+
+bool LeptonHardwareTransport::EnableVsync(unsigned int gpio, int phase_delay) {
+    DisableVsync();
+    if (!leptonI2C_EnableVsync(i2c_port_, phase_delay)) {
+        return false;
+    }
+    try {
+        vsync_fd_ = leptonGPIO_OpenEdge(gpio);
+    }
+    catch (...) {
+        leptonI2C_DisableVsync(i2c_port_);
+        return false;
+    }
+    vsync_gpio_ = gpio;
+    return true;
+}
+
+void LeptonHardwareTransport::DisableVsync() {
+    if (vsync_fd_ >= 0) {
+        leptonI2C_DisableVsync(i2c_port_);
+        leptonGPIO_Close(vsync_gpio_, vsync_fd_);
+        vsync_fd_ = -1;
+    }
+}
+
+bool LeptonHardwareTransport::WaitVsync(uint32_t timeout) {
+
+    // Edge events are reported as priority data on the sysfs value file
+    pollfd vsync{vsync_fd_, POLLPRI | POLLERR, 0};
+    const int timeout_ms{static_cast<int>((timeout + 999) / 1000)};
+    if (poll(&vsync, 1, timeout_ms) <= 0) {
+        return false;
+    }
+
+    // Clear the edge
+    char value[4];
+    lseek(vsync_fd_, 0, SEEK_SET);
+    if (read(vsync_fd_, value, sizeof(value)) < 0) {
+        return false;
+    }
+    return true;
+}
+
+//============================================================================
+// Telemetry
+//============================================================================
+
+bool LeptonHardwareTransport::SetTelemetry(LeptonTelemetryMode mode) {
+    if (mode == TELEMETRY_OFF) {
+        return leptonI2C_DisableTelemetry(i2c_port_);
+    }
+    return leptonI2C_EnableTelemetry(i2c_port_, mode == TELEMETRY_HEADER);
+}
+
+//============================================================================
+// Timing
+//============================================================================
+
+void LeptonHardwareTransport::Wait(uint32_t microseconds) {
+    usleep(microseconds);
+}
@@ -0,0 +1,359 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <LeptonUnpack.h>
+
+// SIMD
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LEPI_UNPACK_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define LEPI_UNPACK_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LEPI_UNPACK_SSE2
+#endif
+
+
+// VoSPI packet header size in bytes
+constexpr uint32_t kPacketHeaderSize{4};
+
+// Telemetry row A word offsets (32 bit values are sent LSW first)
+constexpr uint32_t kTelemetryTimeCounter{1};
+constexpr uint32_t kTelemetryStatus{3};
+constexpr uint32_t kTelemetryFrameCounter{20};
+constexpr uint32_t kTelemetryFpaTemperature{24};
+constexpr uint32_t kTelemetryHousingTemperature{26};
+
+// Telemetry status bits
+constexpr uint32_t kTelemetryFFCDesired{0x00000008};
+constexpr uint32_t kTelemetryFFCStateShift{4};
+constexpr uint32_t kTelemetryFFCStateMask{0x3};
+
+
+/**
+ * @brief Swap big endian pixels to host byte order (scalar)
+ */
+static inline void SwapPixels(const uint8_t* src, uint16_t* dst, uint32_t num_pixels) {
+    for (uint32_t i = 0; i < num_pixels; ++i) {
+        dst[i] = static_cast<uint16_t>((src[2 * i] << 8) | src[2 * i + 1]);
+    }
+}
+
+/**
+ * @brief Swap the bytes of one packet payload
+ */
+static inline void SwapPayload(const uint8_t* src, uint16_t* dst, uint32_t payload_size) {
+
+    auto out = reinterpret_cast<uint8_t *>(dst);
+    uint32_t i{0};
+
+#if defined(LEPI_UNPACK_NEON)
+    for (; i + 16 <= payload_size; i += 16) {
+        vst1q_u8(out + i, vrev16q_u8(vld1q_u8(src + i)));
+    }
+#elif defined(LEPI_UNPACK_AVX2)
+    const __m256i swap_mask = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 32 <= payload_size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                            _mm256_shuffle_epi8(v, swap_mask));
+    }
+#endif
+#if defined(LEPI_UNPACK_SSE2) || defined(LEPI_UNPACK_AVX2)
+    for (; i + 16 <= payload_size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+#endif
+
+    SwapPixels(src + i, dst + i / 2, (payload_size - i) / 2);
+}
+
+// Lepton unpack packets to U16 frame
+void LeptonUnpack16(const uint8_t* packets,
+                    uint32_t num_packets,
+                    uint32_t packet_size,
+                    uint16_t* frame) {
+
+    // Walk packet by packet, skipping the header once per packet
+    const uint32_t payload_size{packet_size - kPacketHeaderSize};
+    const uint32_t pixels_per_packet{payload_size / 2};
+    for (uint32_t p = 0; p < num_packets; ++p) {
+        SwapPayload(packets + p * packet_size + kPacketHeaderSize,
+                    frame + p * pixels_per_packet,
+                    payload_size);
+    }
+}
+
+// Lepton unpack packets to U16 frame, and find frame min/max
+void LeptonUnpack16MinMax(const uint8_t* packets,
+                          uint32_t num_packets,
+                          uint32_t packet_size,
+                          uint16_t* frame,
+                          uint16_t& min_value,
+                          uint16_t& max_value) {
+
+    const uint32_t payload_size{packet_size - kPacketHeaderSize};
+    const uint32_t pixels_per_packet{payload_size / 2};
+    uint16_t lo{0xFFFF};
+    uint16_t hi{0};
+
+#if defined(LEPI_UNPACK_NEON)
+    uint16x8_t vlo = vdupq_n_u16(0xFFFF);
+    uint16x8_t vhi = vdupq_n_u16(0);
+#elif defined(LEPI_UNPACK_AVX2)
+    const __m256i swap_mask = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    __m256i vlo = _mm256_set1_epi16(-1);
+    __m256i vhi = _mm256_setzero_si256();
+#elif defined(LEPI_UNPACK_SSE2)
+    // SSE2 has only signed 16 bit min/max, so values are biased by 0x8000
+    const __m128i bias = _mm_set1_epi16(-32768);
+    __m128i vlo = _mm_set1_epi16(32767);
+    __m128i vhi = _mm_set1_epi16(-32768);
+#endif
+
+    for (uint32_t p = 0; p < num_packets; ++p) {
+        const uint8_t* src{packets + p * packet_size + kPacketHeaderSize};
+        uint16_t* dst{frame + p * pixels_per_packet};
+        auto out = reinterpret_cast<uint8_t *>(dst);
+        uint32_t i{0};
+
+#if defined(LEPI_UNPACK_NEON)
+        for (; i + 16 <= payload_size; i += 16) {
+            uint16x8_t v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + i)));
+            vst1q_u8(out + i, vreinterpretq_u8_u16(v));
+            vlo = vminq_u16(vlo, v);
+            vhi = vmaxq_u16(vhi, v);
+        }
+#elif defined(LEPI_UNPACK_AVX2)
+        for (; i + 32 <= payload_size; i += 32) {
+            __m256i v = _mm256_shuffle_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)), swap_mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), v);
+            vlo = _mm256_min_epu16(vlo, v);
+            vhi = _mm256_max_epu16(vhi, v);
+        }
+#elif defined(LEPI_UNPACK_SSE2)
+        for (; i + 16 <= payload_size; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), v);
+            v = _mm_xor_si128(v, bias);
+            vlo = _mm_min_epi16(vlo, v);
+            vhi = _mm_max_epi16(vhi, v);
+        }
+#endif
+
+        // Scalar tail
+        for (; i < payload_size; i += 2) {
+            const uint16_t value{static_cast<uint16_t>((src[i] << 8) | src[i + 1])};
+            dst[i / 2] = value;
+            lo = value < lo ? value : lo;
+            hi = value > hi ? value : hi;
+        }
+    }
+
+    // Reduce vector lanes
+#if defined(LEPI_UNPACK_NEON)
+    uint16_t lanes_lo[8], lanes_hi[8];
+    vst1q_u16(lanes_lo, vlo);
+    vst1q_u16(lanes_hi, vhi);
+    for (int k = 0; k < 8; ++k) {
+        lo = lanes_lo[k] < lo ? lanes_lo[k] : lo;
+        hi = lanes_hi[k] > hi ? lanes_hi[k] : hi;
+    }
+#elif defined(LEPI_UNPACK_AVX2)
+    uint16_t lanes_lo[16], lanes_hi[16];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes_lo), vlo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes_hi), vhi);
+    for (int k = 0; k < 16; ++k) {
+        lo = lanes_lo[k] < lo ? lanes_lo[k] : lo;
+        hi = lanes_hi[k] > hi ? lanes_hi[k] : hi;
+    }
+#elif defined(LEPI_UNPACK_SSE2)
+    uint16_t lanes_lo[8], lanes_hi[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes_lo), _mm_xor_si128(vlo, bias));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes_hi), _mm_xor_si128(vhi, bias));
+    for (int k = 0; k < 8; ++k) {
+        lo = lanes_lo[k] < lo ? lanes_lo[k] : lo;
+        hi = lanes_hi[k] > hi ? lanes_hi[k] : hi;
+    }
+#endif
+
+    min_value = lo;
+    max_value = hi;
+}
+
+// Lepton find frame min/max
+void LeptonMinMax(const uint16_t* frame,
+                  uint32_t size,
+                  uint16_t& min_value,
+                  uint16_t& max_value) {
+
+    uint16_t lo{0xFFFF};
+    uint16_t hi{0};
+    uint32_t i{0};
+
+#if defined(LEPI_UNPACK_NEON)
+    uint16x8_t vlo = vdupq_n_u16(0xFFFF);
+    uint16x8_t vhi = vdupq_n_u16(0);
+    for (; i + 8 <= size; i += 8) {
+        uint16x8_t v = vld1q_u16(frame + i);
+        vlo = vminq_u16(vlo, v);
+        vhi = vmaxq_u16(vhi, v);
+    }
+    uint16_t lanes_lo[8], lanes_hi[8];
+    vst1q_u16(lanes_lo, vlo);
+    vst1q_u16(lanes_hi, vhi);
+    for (int k = 0; k < 8; ++k) {
+        lo = lanes_lo[k] < lo ? lanes_lo[k] : lo;
+        hi = lanes_hi[k] > hi ? lanes_hi[k] : hi;
+    }
+#elif defined(LEPI_UNPACK_AVX2)
+    __m256i vlo = _mm256_set1_epi16(-1);
+    __m256i vhi = _mm256_setzero_si256();
+    for (; i + 16 <= size; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(frame + i));
+        vlo = _mm256_min_epu16(vlo, v);
+        vhi = _mm256_max_epu16(vhi, v);
+    }
+    uint16_t lanes_lo[16], lanes_hi[16];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes_lo), vlo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes_hi), vhi);
+    for (int k = 0; k < 16; ++k) {
+        lo = lanes_lo[k] < lo ? lanes_lo[k] : lo;
+        hi = lanes_hi[k] > hi ? lanes_hi[k] : hi;
+    }
+#elif defined(LEPI_UNPACK_SSE2)
+    const __m128i bias = _mm_set1_epi16(-32768);
+    __m128i vlo = _mm_set1_epi16(32767);
+    __m128i vhi = _mm_set1_epi16(-32768);
+    for (; i + 8 <= size; i += 8) {
+        __m128i v = _mm_xor_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + i)), bias);
+        vlo = _mm_min_epi16(vlo, v);
+        vhi = _mm_max_epi16(vhi, v);
+    }
+    uint16_t lanes_lo[8], lanes_hi[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes_lo), _mm_xor_si128(vlo, bias));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes_hi), _mm_xor_si128(vhi, bias));
+    for (int k = 0; k < 8; ++k) {
+        lo = lanes_lo[k] < lo ? lanes_lo[k] : lo;
+        hi = lanes_hi[k] > hi ? lanes_hi[k] : hi;
+    }
+#endif
+
+    // Scalar tail
+    for (; i < size; ++i) {
+        lo = frame[i] < lo ? frame[i] : lo;
+        hi = frame[i] > hi ? frame[i] : hi;
+    }
+
+    min_value = lo;
+    max_value = hi;
+}
+
+// Lepton scale U16 frame to U8
+void LeptonScale8(const uint16_t* frame,
+                  uint32_t size,
+                  uint16_t min_value,
+                  uint16_t max_value,
+                  uint8_t* frame_u8) {
+
+    // Flat frame, nothing to scale
+    const uint32_t diff{static_cast<uint32_t>(max_value - min_value)};
+    if (max_value <= min_value) {
+        for (uint32_t i = 0; i < size; ++i) {
+            frame_u8[i] = 0;
+        }
+        return;
+    }
+
+    // Q16 fixed point scale, rounded up so max_value maps to 255. Since
+    // (value - min_value) <= diff, the product stays below 2^25.
+    const uint32_t scale{((255u << 16) + diff - 1) / diff};
+    for (uint32_t i = 0; i < size; ++i) {
+        frame_u8[i] = static_cast<uint8_t>(((frame[i] - min_value) * scale) >> 16);
+    }
+}
+
+// Lepton unpack packets to U16 frame (scalar reference)
+void LeptonUnpack16Scalar(const uint8_t* packets,
+                          uint32_t num_packets,
+                          uint32_t packet_size,
+                          uint16_t* frame) {
+
+    const uint32_t pixels_per_packet{(packet_size - kPacketHeaderSize) / 2};
+    for (uint32_t p = 0; p < num_packets; ++p) {
+        SwapPixels(packets + p * packet_size + kPacketHeaderSize,
+                   frame + p * pixels_per_packet,
+                   pixels_per_packet);
+    }
+}
+
+// Lepton decode telemetry row A
+void LeptonUnpackTelemetry(const uint8_t* packet, LeptonFrameMetadata& metadata) {
+
+    // Telemetry words are big endian, like the pixels
+    const uint8_t* words{packet + kPacketHeaderSize};
+    auto word = [words](uint32_t index) -> uint32_t {
+        return (static_cast<uint32_t>(words[2 * index]) << 8) | words[2 * index + 1];
+    };
+    auto dword = [&word](uint32_t index) -> uint32_t {
+        return word(index) | (word(index + 1) << 16);
+    };
+
+    const uint32_t status{dword(kTelemetryStatus)};
+    metadata.valid = true;
+    metadata.frame_counter = dword(kTelemetryFrameCounter);
+    metadata.time_counter = dword(kTelemetryTimeCounter);
+    metadata.fpa_temperature = static_cast<uint16_t>(word(kTelemetryFpaTemperature));
+    metadata.housing_temperature = static_cast<uint16_t>(word(kTelemetryHousingTemperature));
+    metadata.ffc_state = static_cast<LeptonFFCState>(
+        (status >> kTelemetryFFCStateShift) & kTelemetryFFCStateMask);
+    metadata.ffc_desired = (status & kTelemetryFFCDesired) != 0;
+}
+
+const char* LeptonUnpackKernel() {
+#if defined(LEPI_UNPACK_NEON)
+    return "NEON";
+#elif defined(LEPI_UNPACK_AVX2)
+    return "AVX2";
+#elif defined(LEPI_UNPACK_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
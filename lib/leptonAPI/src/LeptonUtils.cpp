@@ -36,60 +36,58 @@
 // C/C++
 #include <stdio.h>
 #include <inttypes.h>
+#include <fstream>
 
 
 //============================================================================
 // Lepton I2C Commands
 //============================================================================
 
-bool _connected{false};
-LEP_CAMERA_PORT_DESC_T _port;
-
 // Open Lepton I2C
-void leptonI2C_connect() {
-    LEP_RESULT result = LEP_OpenPort(kI2CPortID, kI2CPortType, kI2CPortBaudRate, &_port);
+void leptonI2C_connect(LeptonI2CPort& port, LEP_UINT16 port_id) {
+    LEP_RESULT result = LEP_OpenPort(port_id, kI2CPortType, kI2CPortBaudRate, &port.desc);
     if (result == LEP_OK) {
-        std::cout << "Open I2C port: " <<_port.portID
-                  << ", with address " << static_cast<int>(_port.deviceAddress)
+        std::cout << "Open I2C port: " << port.desc.portID
+                  << ", with address " << static_cast<int>(port.desc.deviceAddress)
                   << std::endl;
     }
     else {
         std::cerr << "Unable to open I2C communication.";
         throw std::runtime_error("I2C connection failed");
     }
-    _connected = true;
+    port.connected = true;
 }
 
 // Close Lepton I2C
-void leptonI2C_disconnect() {
-	LEP_RESULT result = LEP_ClosePort(&_port);
+void leptonI2C_disconnect(LeptonI2CPort& port) {
+	LEP_RESULT result = LEP_ClosePort(&port.desc);
     if (result == LEP_OK) {
-        std::cout << "Close I2C port: " <<_port.portID
-                  << ", with address " << static_cast<int>(_port.deviceAddress)
+        std::cout << "Close I2C port: " << port.desc.portID
+                  << ", with address " << static_cast<int>(port.desc.deviceAddress)
                   << std::endl;
     }
     else {
         std::cerr << "Unable to close I2C communication.";
         throw std::runtime_error("I2C close connection failed");
     }
-    _connected = false;
+    port.connected = false;
 }
 
 // Set camera shutter mode to manual
-bool leptonI2C_ShutterManual() {
-    if (_connected) {
+bool leptonI2C_ShutterManual(LeptonI2CPort& port) {
+    if (port.connected) {
         // Get FFC-shutter mode
         LEP_SYS_FFC_SHUTTER_MODE_OBJ_T mode;
-        LEP_RESULT res = LEP_GetSysFfcShutterModeObj(&_port, &mode);
+        LEP_RESULT res = LEP_GetSysFfcShutterModeObj(&port.desc, &mode);
         if (res == LEP_OK) {
 
             std::cout << "shutter mode " << mode.shutterMode << std::endl;
             // Set mode to manual
             mode.shutterMode = LEP_SYS_FFC_SHUTTER_MODE_MANUAL;
-            res = LEP_SetSysFfcShutterModeObj(&_port, mode);
+            res = LEP_SetSysFfcShutterModeObj(&port.desc, mode);
             if (res == LEP_OK) {
                 // Check mode
-                res = LEP_GetSysFfcShutterModeObj(&_port, &mode);
+                res = LEP_GetSysFfcShutterModeObj(&port.desc, &mode);
                 std::cout << "shutter mode " << mode.shutterMode << std::endl;
             }
         }
@@ -99,56 +97,56 @@ bool leptonI2C_ShutterManual() {
 }
 
 // Close/Open camera shutter
-bool leptonI2C_ShutterOpen() {
-    if (_connected) {
+bool leptonI2C_ShutterOpen(LeptonI2CPort& port) {
+    if (port.connected) {
         LEP_SYS_SHUTTER_POSITION_E position = LEP_SYS_SHUTTER_POSITION_OPEN;
-        return LEP_SetSysShutterPosition(&_port, position) == LEP_OK;
+        return LEP_SetSysShutterPosition(&port.desc, position) == LEP_OK;
     }
     return false;
 } 
-bool leptonI2C_ShutterClose() {
-    if (_connected) {
+bool leptonI2C_ShutterClose(LeptonI2CPort& port) {
+    if (port.connected) {
         LEP_SYS_SHUTTER_POSITION_E position = LEP_SYS_SHUTTER_POSITION_CLOSED;
-        return LEP_SetSysShutterPosition(&_port, position) == LEP_OK;
+        return LEP_SetSysShutterPosition(&port.desc, position) == LEP_OK;
     }
     return false;
 } 
 
 // Perform FFC
-bool leptonI2C_FFC() {
-    if (_connected) {
-        return LEP_RunSysFFCNormalization(&_port) == LEP_OK;
+bool leptonI2C_FFC(LeptonI2CPort& port) {
+    if (port.connected) {
+        return LEP_RunSysFFCNormalization(&port.desc) == LEP_OK;
     }
     return false;
 }
 
 // Reboot sensor
-bool leptonI2C_Reboot() {
-    if (_connected) {
+bool leptonI2C_Reboot(LeptonI2CPort& port) {
+    if (port.connected) {
         std::cout << "Reboot lepton sensor..." << std::endl;
-        return LEP_RunOemReboot(&_port) == LEP_OK;
+        return LEP_RunOemReboot(&port.desc) == LEP_OK;
     }
     return false;
 }
 
 // Get internal temperature
-unsigned int leptonI2C_InternalTemp() {
+unsigned int leptonI2C_InternalTemp(LeptonI2CPort& port) {
 
     LEP_SYS_FPA_TEMPERATURE_KELVIN_T sensor_temp_kelvin{0};
-    if (_connected) {
-        LEP_GetSysFpaTemperatureKelvin(&_port, &sensor_temp_kelvin);
+    if (port.connected) {
+        LEP_GetSysFpaTemperatureKelvin(&port.desc, &sensor_temp_kelvin);
     }
 
     return static_cast<unsigned int>(sensor_temp_kelvin);
 }
 
 // Get lepton type
-unsigned int leptonI2C_SensorNumber() {
+unsigned int leptonI2C_SensorNumber(LeptonI2CPort& port) {
 
     //LEP_SYS_FLIR_SERIAL_NUMBER_T sysSerialNumberBuf;
-    //LEP_GetSysFlirSerialNumber(&_port, &sysSerialNumberBuf);
+    //LEP_GetSysFlirSerialNumber(&port.desc, &sysSerialNumberBuf);
     LEP_SYS_VIDEO_ROI_T sceneRoi;
-    LEP_GetSysSceneRoi(&_port, &sceneRoi);
+    LEP_GetSysSceneRoi(&port.desc, &sceneRoi);
     if (sceneRoi.endCol == 79 && sceneRoi.endRow == 59) {
         return 2;
     }
@@ -158,30 +156,124 @@ unsigned int leptonI2C_SensorNumber() {
     return 0;
 }
 
+// Set several 32 bit (enum) attributes, in one command batch
+static bool leptonI2C_SetEnums(LeptonI2CPort& port, const LEP_COMMAND_ID* ids,
+                               LEP_UINT32* values, LEP_UINT16 count) {
+    LEP_I2C_BATCH_ENTRY_T batch[4];
+    if (!port.connected || count > 4) {
+        return false;
+    }
+    for (LEP_UINT16 i = 0; i < count; ++i) {
+        batch[i].type = LEP_I2C_BATCH_SET;
+        batch[i].commandID = ids[i];
+        batch[i].attributePtr = reinterpret_cast<LEP_ATTRIBUTE_T_PTR>(&values[i]);
+        batch[i].attributeWordLength = 2;   // enums are 32 bit
+    }
+    return LEP_RunBatch(&port.desc, batch, count) == LEP_OK;
+}
+
+// Enable VSYNC output
+bool leptonI2C_EnableVsync(LeptonI2CPort& port, int phase_delay) {
+    if (phase_delay < LEP_OEM_VSYNC_DELAY_MINUS_3 || phase_delay > LEP_OEM_VSYNC_DELAY_PLUS_3) {
+        return false;
+    }
+    const LEP_COMMAND_ID ids[]{LEP_CID_OEM_GPIO_MODE_SELECT, LEP_CID_OEM_GPIO_VSYNC_PHASE_DELAY};
+    LEP_UINT32 values[]{LEP_OEM_GPIO_MODE_VSYNC, static_cast<LEP_UINT32>(phase_delay)};
+    return leptonI2C_SetEnums(port, ids, values, 2);
+}
+
+// Disable VSYNC output
+bool leptonI2C_DisableVsync(LeptonI2CPort& port) {
+    if (port.connected) {
+        return LEP_SetOemGpioMode(&port.desc, LEP_OEM_GPIO_MODE_GPIO) == LEP_OK;
+    }
+    return false;
+}
+
+// Enable telemetry rows
+bool leptonI2C_EnableTelemetry(LeptonI2CPort& port, bool header) {
+    const LEP_COMMAND_ID ids[]{LEP_CID_SYS_TELEMETRY_LOCATION, LEP_CID_SYS_TELEMETRY_ENABLE_STATE};
+    LEP_UINT32 values[]{header ? LEP_TELEMETRY_LOCATION_HEADER : LEP_TELEMETRY_LOCATION_FOOTER,
+                        LEP_TELEMETRY_ENABLED};
+    return leptonI2C_SetEnums(port, ids, values, 2);
+}
+
+// Disable telemetry rows
+bool leptonI2C_DisableTelemetry(LeptonI2CPort& port) {
+    if (port.connected) {
+        return LEP_SetSysTelemetryEnableState(&port.desc, LEP_TELEMETRY_DISABLED) == LEP_OK;
+    }
+    return false;
+}
+
+//============================================================================
+// GPIO (sysfs)
+//============================================================================
+
+// Write a value to a sysfs GPIO file
+static bool leptonGPIO_Write(const std::string& path, const std::string& value) {
+    std::ofstream file(path);
+    file << value;
+    file.flush();
+    return file.good();
+}
+
+// Open GPIO edge events
+int leptonGPIO_OpenEdge(unsigned int gpio) {
+
+    // Export GPIO (fails if already exported, which is fine)
+    const std::string gpio_path{"/sys/class/gpio/gpio" + std::to_string(gpio)};
+    leptonGPIO_Write("/sys/class/gpio/export", std::to_string(gpio));
+
+    // Input, with interrupt on the rising edge
+    if (!leptonGPIO_Write(gpio_path + "/direction", "in") ||
+        !leptonGPIO_Write(gpio_path + "/edge", "rising")) {
+        std::cerr << "Unable to configure GPIO " << gpio << std::endl;
+        throw std::runtime_error("GPIO config failed.");
+    }
+
+    int fd = open((gpio_path + "/value").c_str(), O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        std::cerr << "Unable to open GPIO " << gpio << std::endl;
+        throw std::runtime_error("GPIO open failed.");
+    }
+
+    // Clear the pending edge
+    char value[4];
+    if (read(fd, value, sizeof(value)) < 0) {
+        std::cerr << "Unable to read GPIO " << gpio << std::endl;
+    }
+
+    std::cout << "Open GPIO: " << gpio << ", with address " << fd << std::endl;
+    return fd;
+}
+
+// Close GPIO
+void leptonGPIO_Close(unsigned int gpio, int fd) {
+    close(fd);
+    leptonGPIO_Write("/sys/class/gpio/unexport", std::to_string(gpio));
+}
+
 //============================================================================
 // Lepton SPI Communication
 //============================================================================
 
 // SPI config
-int spi_fd{-1};
-unsigned char spi_mode{SPI_MODE_3};
-unsigned char spi_bits_per_word{8};
+constexpr unsigned char kSPIMode{SPI_MODE_3};
+constexpr unsigned char kSPIBitsPerWord{8};
 
 // Open SPI port
-void leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
+int leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
 {
     int status_value{-1};
+    unsigned char spi_mode{kSPIMode};
+    unsigned char spi_bits_per_word{kSPIBitsPerWord};
 
-    // Select SPI device and open communication
-    if (spi_device) {
-        spi_fd = open(std::string("/dev/spidev0.1").c_str(), O_RDWR);
-    }
-    else {
-        spi_fd = open(std::string("/dev/spidev0.0").c_str(), O_RDWR);
-    }
-
+    // Select SPI device (SPI0 chip select) and open communication
+    const std::string spi_path{"/dev/spidev0." + std::to_string(spi_device)};
+    int spi_fd = open(spi_path.c_str(), O_RDWR);
     if (spi_fd < 0) {
-        std::cerr << "Error - Could not open SPI device" << std::endl;
+        std::cerr << "Error - Could not open SPI device " << spi_path << std::endl;
         throw std::runtime_error("Connection failed.");
     }
 
@@ -193,6 +285,7 @@ void leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
     status_value = ioctl(spi_fd, SPI_IOC_WR_MODE, &spi_mode);
     if(status_value < 0) {
         std::cerr << "Could not set SPIMode (WR)...ioctl fail" << std::endl;
+        close(spi_fd);
         throw std::runtime_error("SPI config failed.");
     }
 
@@ -200,6 +293,7 @@ void leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
     status_value = ioctl(spi_fd, SPI_IOC_RD_MODE, &spi_mode);
     if(status_value < 0) {
         std::cerr << "Could not set SPIMode (RD)...ioctl fail" << std::endl;
+        close(spi_fd);
         throw std::runtime_error("SPI config failed.");
     }
 
@@ -207,6 +301,7 @@ void leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
     status_value = ioctl(spi_fd, SPI_IOC_WR_BITS_PER_WORD, &spi_bits_per_word);
     if(status_value < 0) {
         std::cerr << "Could not set SPI bitsPerWord (WR)...ioctl fail" << std::endl;
+        close(spi_fd);
         throw std::runtime_error("SPI config failed.");
     }
 
@@ -214,6 +309,7 @@ void leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
     status_value = ioctl(spi_fd, SPI_IOC_RD_BITS_PER_WORD, &spi_bits_per_word);
     if(status_value < 0) {
         std::cerr << "Could not set SPI bitsPerWord(RD)...ioctl fail" << std::endl;
+        close(spi_fd);
         throw std::runtime_error("SPI config failed.");
     }
 
@@ -221,6 +317,7 @@ void leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
     status_value = ioctl(spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed);
     if(status_value < 0) {
         std::cerr << "Could not set SPI speed (WR)...ioctl fail" << std::endl;
+        close(spi_fd);
         throw std::runtime_error("SPI config failed.");
     }
 
@@ -228,17 +325,19 @@ void leptonSPI_OpenPort (int spi_device, uint32_t spi_speed)
     status_value = ioctl(spi_fd, SPI_IOC_RD_MAX_SPEED_HZ, &spi_speed);
     if(status_value < 0) {
         std::cerr << "Could not set SPI speed (RD)...ioctl fail" << std::endl;
+        close(spi_fd);
         throw std::runtime_error("SPI config failed.");
     }
 
     std::cout << "Open SPI port: " << spi_device
               << ", with address " << spi_fd
               << std::endl;
+    return spi_fd;
 }
 
 
 // Close SPI connection
-void leptonSPI_ClosePort(int spi_device)
+void leptonSPI_ClosePort(int spi_device, int spi_fd)
 {
     int status_value{-1};
 
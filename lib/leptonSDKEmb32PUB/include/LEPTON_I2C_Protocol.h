@@ -77,9 +77,17 @@ extern "C"
 /** EXPORTED DEFINES                                                         **/
 /******************************************************************************/
 
-    /* Timeout count to wait for I2C command to complete
+    /* Max time the camera can stay BUSY, before a command or while running
+    ** it, in microseconds
     */ 
-    #define LEPTON_I2C_COMMAND_BUSY_WAIT_COUNT              1000
+    #define LEP_I2C_BUSY_TIMEOUT_US                         1000000
+
+    /* STATUS register polling while the camera is BUSY: back to back polls
+    ** first, then polls spaced by a doubling interval (microseconds)
+    */ 
+    #define LEP_I2C_BUSY_POLL_SPINS                         4
+    #define LEP_I2C_BUSY_POLL_MIN_SLEEP_US                  100
+    #define LEP_I2C_BUSY_POLL_MAX_SLEEP_US                  5000
 
 /******************************************************************************/
 /** EXPORTED TYPE DEFINITIONS                                                **/
@@ -94,6 +102,30 @@ extern "C"
 
     }LEP_I2C_COMMAND_STATUS_E, *LEP_I2C_COMMAND_STATUS_E_PTR;
 
+    /* Batched command type
+    */ 
+    typedef enum LEP_I2C_BATCH_TYPE_TAG
+    {
+        LEP_I2C_BATCH_GET = 0,
+        LEP_I2C_BATCH_SET,
+        LEP_I2C_BATCH_RUN,
+        LEP_I2C_END_BATCH_TYPE
+
+    }LEP_I2C_BATCH_TYPE_E, *LEP_I2C_BATCH_TYPE_E_PTR;
+
+    /* Batched command: GET/SET an attribute, or RUN a command. The command
+    ** ID is given without its type bits, as for the SDK calls.
+    */ 
+    typedef struct LEP_I2C_BATCH_ENTRY_TAG
+    {
+        LEP_I2C_BATCH_TYPE_E type;
+        LEP_COMMAND_ID commandID;
+        LEP_ATTRIBUTE_T_PTR attributePtr;       /* GET/SET data, unused by RUN */
+        LEP_UINT16 attributeWordLength;
+        LEP_RESULT result;                      /* Set by LEP_I2C_RunBatch */
+
+    }LEP_I2C_BATCH_ENTRY_T, *LEP_I2C_BATCH_ENTRY_T_PTR;
+
 /******************************************************************************/
 /** EXPORTED PUBLIC DATA                                                     **/
 /******************************************************************************/
@@ -128,6 +160,14 @@ extern "C"
     extern LEP_RESULT LEP_I2C_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
                                          LEP_COMMAND_ID commandID);
 
+    /* Runs a batch of commands back to back, on an open port. Stops at the
+    ** first failed command: its result is returned, and the commands after
+    ** it are not run (LEP_OPERATION_CANCELED).
+    */ 
+    extern LEP_RESULT LEP_I2C_RunBatch(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                       LEP_I2C_BATCH_ENTRY_T_PTR entries,
+                                       LEP_UINT16 numEntries);
+
     extern LEP_RESULT LEP_I2C_ReadData(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr);
 
     extern LEP_RESULT LEP_I2C_WriteData(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr);
@@ -154,6 +154,10 @@ extern "C"
     extern LEP_RESULT LEP_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
                                      LEP_COMMAND_ID commandID);
 
+    extern LEP_RESULT LEP_RunBatch(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                   LEP_I2C_BATCH_ENTRY_T_PTR entries,
+                                   LEP_UINT16 numEntries);
+
     extern LEP_RESULT LEP_DirectWriteBuffer(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
                                             LEP_ATTRIBUTE_T_PTR attributePtr,
                                             LEP_UINT16 attributeWordLength);
@@ -45,6 +45,16 @@ extern "C"
 /** EXPORTED TYPE DEFINITIONS                                                **/
 /******************************************************************************/
 
+    /* i2c-dev bus system calls (open, ioctl and close of /dev/i2c-<portID>),
+    ** replaceable to run the linux_I2C.c driver against a fake bus master
+    */ 
+    typedef struct
+    {
+        int (*open)(const char *path, int flags);
+        int (*ioctl)(int fd, unsigned long request, void *arg);
+        int (*close)(int fd);
+    } DEV_I2C_BUS_OPS_T, *DEV_I2C_BUS_OPS_T_PTR;
+
 /******************************************************************************/
 /** EXPORTED PUBLIC DATA                                                     **/
 /******************************************************************************/
@@ -53,10 +63,13 @@ extern "C"
 /** EXPORTED PUBLIC FUNCTIONS                                                **/
 /******************************************************************************/
 
+    /* Device-Specific I2C Master driver, implemented by raspi_I2C.c (bcm2835)
+    ** or linux_I2C.c (i2c-dev), see LEPTON_I2C_BACKEND in CMake
+    */ 
     extern LEP_RESULT DEV_I2C_MasterInit(LEP_UINT16 portID,
                                          LEP_UINT16 *BaudRate);
 
-    extern LEP_RESULT DEV_I2C_MasterClose();
+    extern LEP_RESULT DEV_I2C_MasterClose(LEP_UINT16 portID);
 
     extern LEP_RESULT DEV_I2C_MasterReset(void );
 
@@ -94,6 +107,11 @@ extern "C"
 
     extern LEP_RESULT DEV_I2C_MasterStatus(void );
 
+    /* i2c-dev backend only: replaces the bus system calls (NULL restores
+    ** them). Set while no port is open.
+    */ 
+    extern void DEV_I2C_SetBusOps(const DEV_I2C_BUS_OPS_T *ops);
+
 /******************************************************************************/
     #ifdef __cplusplus
 }
@@ -69,6 +69,9 @@
 #include "LEPTON_I2C_Reg.h"
 #include "crc16.h"
 
+#include <pthread.h>
+#include <time.h>
+
 /******************************************************************************/
 /** LOCAL DEFINES                                                            **/
 /******************************************************************************/
@@ -82,10 +85,36 @@
 /** PRIVATE DATA DECLARATIONS                                                **/
 /******************************************************************************/
 
+/* Serializes the I2C transactions of every camera in the process. A
+** transaction (e.g. data block write, command write and ready polls) runs
+** with the lock held, as do the port open/close, which update the driver
+** open port tables.
+*/
+static pthread_mutex_t i2cTransactionMutex = PTHREAD_MUTEX_INITIALIZER;
+
 /******************************************************************************/
 /** PRIVATE FUNCTION DECLARATIONS                                            **/
 /******************************************************************************/
 
+static LEP_RESULT LEP_I2C_WaitNotBusy(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                      LEP_UINT16 *statusReg);
+
+static LEP_RESULT LEP_I2C_GetAttributeCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                              LEP_COMMAND_ID commandID,
+                                              LEP_ATTRIBUTE_T_PTR attributePtr,
+                                              LEP_UINT16 attributeWordLength,
+                                              LEP_BOOL waitReady);
+
+static LEP_RESULT LEP_I2C_SetAttributeCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                              LEP_COMMAND_ID commandID,
+                                              LEP_ATTRIBUTE_T_PTR attributePtr,
+                                              LEP_UINT16 attributeWordLength,
+                                              LEP_BOOL waitReady);
+
+static LEP_RESULT LEP_I2C_RunCommandCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                            LEP_COMMAND_ID commandID,
+                                            LEP_BOOL waitReady);
+
 /******************************************************************************/
 /** EXPORTED PUBLIC DATA                                                     **/
 /******************************************************************************/
@@ -102,9 +131,11 @@ LEP_RESULT LEP_I2C_OpenPort(LEP_UINT16 portID,
    LEP_RESULT result;
    LEP_UINT16 statusReg;
 
+   pthread_mutex_lock( &i2cTransactionMutex );
    result = LEP_I2C_MasterOpen( portID, baudRateInkHz );
    if(result != LEP_OK)
    {
+      pthread_mutex_unlock( &i2cTransactionMutex );
       return(LEP_COMM_INVALID_PORT_ERROR);
    }
 
@@ -129,9 +160,11 @@ LEP_RESULT LEP_I2C_OpenPort(LEP_UINT16 portID,
                                    1 );
       if(result != LEP_OK)
       {
+         pthread_mutex_unlock( &i2cTransactionMutex );
          return(LEP_COMM_NO_DEV);
       }
    }
+   pthread_mutex_unlock( &i2cTransactionMutex );
 
     return(result);
 }
@@ -141,7 +174,9 @@ LEP_RESULT LEP_I2C_ClosePort(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr)
 {
     LEP_RESULT result;
 
+    pthread_mutex_lock( &i2cTransactionMutex );
     result =LEP_I2C_MasterClose( portDescPtr );
+    pthread_mutex_unlock( &i2cTransactionMutex );
 
     return(result);
 }
@@ -151,7 +186,9 @@ LEP_RESULT LEP_I2C_ResetPort(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr)
 {
     LEP_RESULT result;
 
+    pthread_mutex_lock( &i2cTransactionMutex );
     result = LEP_I2C_MasterReset( portDescPtr );
+    pthread_mutex_unlock( &i2cTransactionMutex );
 
     return(result);
 }
@@ -163,9 +200,267 @@ LEP_RESULT LEP_I2C_GetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
                                 LEP_UINT16 attributeWordLength)
 {
     LEP_RESULT result;
+
+    pthread_mutex_lock( &i2cTransactionMutex );
+    result = LEP_I2C_GetAttributeCommand( portDescPtr,
+                                          commandID,
+                                          attributePtr,
+                                          attributeWordLength,
+                                          LEP_TRUE );
+    pthread_mutex_unlock( &i2cTransactionMutex );
+
+    return(result);
+}
+
+
+LEP_RESULT LEP_I2C_SetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                LEP_COMMAND_ID commandID, 
+                                LEP_ATTRIBUTE_T_PTR attributePtr,
+                                LEP_UINT16 attributeWordLength)
+{
+    LEP_RESULT result;
+
+    pthread_mutex_lock( &i2cTransactionMutex );
+    result = LEP_I2C_SetAttributeCommand( portDescPtr,
+                                          commandID,
+                                          attributePtr,
+                                          attributeWordLength,
+                                          LEP_TRUE );
+    pthread_mutex_unlock( &i2cTransactionMutex );
+
+    return(result);
+}
+
+
+LEP_RESULT LEP_I2C_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                              LEP_COMMAND_ID commandID)
+{
+    LEP_RESULT result;
+
+    pthread_mutex_lock( &i2cTransactionMutex );
+    result = LEP_I2C_RunCommandCommand( portDescPtr,
+                                        commandID,
+                                        LEP_TRUE );
+    pthread_mutex_unlock( &i2cTransactionMutex );
+
+    return(result);
+}
+
+
+LEP_RESULT LEP_I2C_RunBatch(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                            LEP_I2C_BATCH_ENTRY_T_PTR entries,
+                            LEP_UINT16 numEntries)
+{
+    LEP_RESULT result = LEP_OK;
+    LEP_UINT16 i;
+
+    if( entries == NULL )
+    {
+        return(LEP_BAD_ARG_POINTER_ERROR);
+    }
+
+    /* Run the commands back to back, as one transaction. The camera is only
+    ** polled for READY before the first command: each command waits until
+    ** the camera completed it, so the camera is ready for the next one.
+    */ 
+    pthread_mutex_lock( &i2cTransactionMutex );
+    for( i = 0; i < numEntries; i++ )
+    {
+        LEP_I2C_BATCH_ENTRY_T_PTR entry = &entries[i];
+        const LEP_BOOL waitReady = (i == 0)? LEP_TRUE: LEP_FALSE;
+
+        if( result != LEP_OK )
+        {
+            /* A command failed, the rest of the batch is not run
+            */ 
+            entry->result = LEP_OPERATION_CANCELED;
+            continue;
+        }
+
+        if( entry->type != LEP_I2C_BATCH_RUN && entry->attributePtr == NULL )
+        {
+            entry->result = LEP_BAD_ARG_POINTER_ERROR;
+        }
+        else if( entry->type == LEP_I2C_BATCH_GET )
+        {
+            entry->result = LEP_I2C_GetAttributeCommand( portDescPtr,
+                                                         entry->commandID | LEP_GET_TYPE,
+                                                         entry->attributePtr,
+                                                         entry->attributeWordLength,
+                                                         waitReady );
+        }
+        else if( entry->type == LEP_I2C_BATCH_SET )
+        {
+            entry->result = LEP_I2C_SetAttributeCommand( portDescPtr,
+                                                         entry->commandID | LEP_SET_TYPE,
+                                                         entry->attributePtr,
+                                                         entry->attributeWordLength,
+                                                         waitReady );
+        }
+        else if( entry->type == LEP_I2C_BATCH_RUN )
+        {
+            entry->result = LEP_I2C_RunCommandCommand( portDescPtr,
+                                                       entry->commandID | LEP_RUN_TYPE,
+                                                       waitReady );
+        }
+        else
+        {
+            entry->result = LEP_RANGE_ERROR;
+        }
+        result = entry->result;
+    }
+    pthread_mutex_unlock( &i2cTransactionMutex );
+
+    return(result);
+}
+
+LEP_RESULT LEP_I2C_DirectReadRegister(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                      LEP_UINT16 regAddress,
+                                      LEP_UINT16 *regValue)
+{
+   LEP_RESULT result = LEP_OK;
+
+   pthread_mutex_lock( &i2cTransactionMutex );
+   result = LEP_I2C_MasterReadRegister( portDescPtr->portID,
+                                        portDescPtr->deviceAddress,
+                                        regAddress,
+                                        regValue);
+   pthread_mutex_unlock( &i2cTransactionMutex );
+
+   return(result);
+}
+
+LEP_RESULT LEP_I2C_GetPortStatus(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr)
+{
+    LEP_RESULT result = LEP_OK;
+
+    return(result);
+}
+
+LEP_RESULT LEP_I2C_GetDeviceAddress(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                    LEP_UINT8* deviceAddress)
+{
+   LEP_RESULT result = LEP_OK;
+
+   if(deviceAddress == NULL)
+   {
+      return(LEP_BAD_ARG_POINTER_ERROR);
+   }
+   *deviceAddress = portDescPtr->deviceAddress;
+
+   return(result);
+}
+
+
+LEP_RESULT LEP_I2C_DirectWriteBuffer(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                     LEP_ATTRIBUTE_T_PTR attributePtr,
+                                     LEP_UINT16 attributeWordLength)
+{
+   LEP_RESULT result = LEP_OK;
+
+   /* WRITE to the DATA Block Buffer
+   */     
+   pthread_mutex_lock( &i2cTransactionMutex );
+   result = LEP_I2C_MasterWriteData(portDescPtr->portID,
+                                    portDescPtr->deviceAddress,
+                                    LEP_I2C_DATA_BUFFER_0,
+                                    attributePtr,
+                                    attributeWordLength );
+   pthread_mutex_unlock( &i2cTransactionMutex );
+
+  
+
+   return(result);
+}
+
+LEP_RESULT LEP_I2C_DirectWriteRegister(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                       LEP_UINT16 regAddress,
+                                       LEP_UINT16 regValue)
+{
+   LEP_RESULT result = LEP_OK;
+
+   pthread_mutex_lock( &i2cTransactionMutex );
+   result = LEP_I2C_MasterWriteRegister(portDescPtr->portID,
+                                        portDescPtr->deviceAddress,
+                                        regAddress, 
+                                        regValue);
+   pthread_mutex_unlock( &i2cTransactionMutex );
+   return(result);
+}
+
+/******************************************************************************/
+/** PRIVATE MODULE FUNCTIONS                                                 **/
+/******************************************************************************/
+
+/* Polls the STATUS REGISTER until the BUSY Bit reports NOT BUSY. The first
+** polls are back to back (most commands complete within a few bus
+** transactions), then the poll interval doubles up to the max interval, so a
+** camera busy for long (e.g. during FFC) does not hog the bus. Gives up with
+** LEP_TIMEOUT_ERROR once the camera was busy for LEP_I2C_BUSY_TIMEOUT_US.
+*/
+static LEP_RESULT LEP_I2C_WaitNotBusy(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                      LEP_UINT16 *statusReg)
+{
+    LEP_RESULT result;
+    LEP_UINT32 polls = 0;
+    LEP_UINT32 sleepUs = LEP_I2C_BUSY_POLL_MIN_SLEEP_US;
+    LEP_UINT64 elapsedUs;
+    struct timespec start, now, pause;
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( ;; )
+    {
+        /* Read the Status REGISTER and peek at the BUSY Bit
+        */ 
+        result = LEP_I2C_MasterReadRegister( portDescPtr->portID,
+                                             portDescPtr->deviceAddress,
+                                             LEP_I2C_STATUS_REG,
+                                             statusReg );
+        if(result != LEP_OK)
+        {
+            return(result);
+        }
+        if( !(*statusReg & LEP_I2C_STATUS_BUSY_BIT_MASK) )
+        {
+            return(LEP_OK);
+        }
+
+        /* Timeout check
+        */ 
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        elapsedUs = (LEP_UINT64)((now.tv_sec - start.tv_sec) * 1000000LL +
+                                 (now.tv_nsec - start.tv_nsec) / 1000L);
+        if( elapsedUs >= LEP_I2C_BUSY_TIMEOUT_US )
+        {
+            return(LEP_TIMEOUT_ERROR);
+        }
+
+        /* Back off
+        */ 
+        if( ++polls > LEP_I2C_BUSY_POLL_SPINS )
+        {
+            if( sleepUs > LEP_I2C_BUSY_TIMEOUT_US - elapsedUs )
+            {
+                sleepUs = (LEP_UINT32)(LEP_I2C_BUSY_TIMEOUT_US - elapsedUs);
+            }
+            pause.tv_sec = sleepUs / 1000000;
+            pause.tv_nsec = (long)(sleepUs % 1000000) * 1000L;
+            nanosleep( &pause, NULL );
+            sleepUs = (sleepUs * 2 < LEP_I2C_BUSY_POLL_MAX_SLEEP_US)? sleepUs * 2: LEP_I2C_BUSY_POLL_MAX_SLEEP_US;
+        }
+    }
+}
+
+
+static LEP_RESULT LEP_I2C_GetAttributeCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                              LEP_COMMAND_ID commandID,
+                                              LEP_ATTRIBUTE_T_PTR attributePtr,
+                                              LEP_UINT16 attributeWordLength,
+                                              LEP_BOOL waitReady)
+{
+    LEP_RESULT result;
     LEP_UINT16 statusReg;
     LEP_INT16 statusCode;
-    LEP_UINT32 done;
     LEP_UINT16 crcExpected, crcActual;
 
     /* Implement the Lepton TWI READ Protocol
@@ -174,23 +469,14 @@ LEP_RESULT LEP_I2C_GetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
     ** command by polling the STATUS REGISTER BUSY Bit until it
     ** reports NOT BUSY.
     */ 
-
-    do
+    if( waitReady )
     {
-        /* Read the Status REGISTER and peek at the BUSY Bit
-        */ 
-        result = LEP_I2C_MasterReadData( portDescPtr->portID,
-                                         portDescPtr->deviceAddress,
-                                         LEP_I2C_STATUS_REG,
-                                         &statusReg,
-                                         1 );
+        result = LEP_I2C_WaitNotBusy( portDescPtr, &statusReg );
         if(result != LEP_OK)
         {
            return(result);
         }
-        done = (statusReg & LEP_I2C_STATUS_BUSY_BIT_MASK)? 0: 1;
-
-    }while( !done );
+    }
 
     /* Set the Lepton's DATA LENGTH REGISTER first to inform the
     ** Lepton Camera how many 16-bit DATA words we want to read.
@@ -221,24 +507,11 @@ LEP_RESULT LEP_I2C_GetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
     ** polling the statusReg REGISTER BUSY Bit until it reports NOT
     ** BUSY.
     */ 
-    do
+    result = LEP_I2C_WaitNotBusy( portDescPtr, &statusReg );
+    if(result != LEP_OK)
     {
-        /* Read the statusReg REGISTER and peek at the BUSY Bit
-        */ 
-        result = LEP_I2C_MasterReadData( portDescPtr->portID,
-                                         portDescPtr->deviceAddress,
-                                         LEP_I2C_STATUS_REG,
-                                         &statusReg,
-                                         1 );
-
-        if(result != LEP_OK)
-        {
-           return(result);
-        }
-        done = (statusReg & LEP_I2C_STATUS_BUSY_BIT_MASK)? 0: 1;
-
-    }while( !done );
-    
+       return(result);
+    }
 
     /* Check statusReg word for Errors?
     */ 
@@ -295,16 +568,15 @@ LEP_RESULT LEP_I2C_GetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
 }
 
 
-LEP_RESULT LEP_I2C_SetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
-                                LEP_COMMAND_ID commandID, 
-                                LEP_ATTRIBUTE_T_PTR attributePtr,
-                                LEP_UINT16 attributeWordLength)
+static LEP_RESULT LEP_I2C_SetAttributeCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                              LEP_COMMAND_ID commandID,
+                                              LEP_ATTRIBUTE_T_PTR attributePtr,
+                                              LEP_UINT16 attributeWordLength,
+                                              LEP_BOOL waitReady)
 {
-    LEP_RESULT result;
+    LEP_RESULT result = LEP_OK;
     LEP_UINT16 statusReg;
     LEP_INT16 statusCode;
-    LEP_UINT32 done;
-    LEP_UINT16 timeoutCount = LEPTON_I2C_COMMAND_BUSY_WAIT_COUNT;
 
     /* Implement the Lepton TWI WRITE Protocol
     */
@@ -312,29 +584,14 @@ LEP_RESULT LEP_I2C_SetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
     ** command by polling the STATUS REGISTER BUSY Bit until it
     ** reports NOT BUSY.
     */ 
-    do
+    if( waitReady )
     {
-        /* Read the Status REGISTER and peek at the BUSY Bit
-        */ 
-        result = LEP_I2C_MasterReadData( portDescPtr->portID,
-                                         portDescPtr->deviceAddress,
-                                         LEP_I2C_STATUS_REG,
-                                         &statusReg,
-                                         1 );
+        result = LEP_I2C_WaitNotBusy( portDescPtr, &statusReg );
         if(result != LEP_OK)
         {
            return(result);
         }
-        done = (statusReg & LEP_I2C_STATUS_BUSY_BIT_MASK)? 0: 1;
-        /* Add timout check */
-        if( timeoutCount-- == 0 )
-        {
-            /* Timed out waiting for command busy to go away
-            */ 
-          return(LEP_TIMEOUT_ERROR);
-
-        }
-    }while( !done );
+    }
 
     if( result == LEP_OK )
     {
@@ -392,22 +649,11 @@ LEP_RESULT LEP_I2C_SetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
                 ** polling the statusReg REGISTER BUSY Bit until it reports NOT
                 ** BUSY.
                 */ 
-                do
+                result = LEP_I2C_WaitNotBusy( portDescPtr, &statusReg );
+                if(result != LEP_OK)
                 {
-                    /* Read the statusReg REGISTER and peek at the BUSY Bit
-                    */ 
-                    result = LEP_I2C_MasterReadData( portDescPtr->portID,
-                                                     portDescPtr->deviceAddress,
-                                                     LEP_I2C_STATUS_REG,
-                                                     &statusReg,
-                                                     1 );
-                    if(result != LEP_OK)
-                    {
-                       return(result);
-                    }
-                    done = (statusReg & LEP_I2C_STATUS_BUSY_BIT_MASK)? 0: 1;
-
-                }while( !done );
+                   return(result);
+                }
 
                     /* Check statusReg word for Errors?
                    */ 
@@ -428,14 +674,13 @@ LEP_RESULT LEP_I2C_SetAttribute(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
 }
 
 
-LEP_RESULT LEP_I2C_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
-                              LEP_COMMAND_ID commandID)
+static LEP_RESULT LEP_I2C_RunCommandCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                                            LEP_COMMAND_ID commandID,
+                                            LEP_BOOL waitReady)
 {
-    LEP_RESULT result;
+    LEP_RESULT result = LEP_OK;
     LEP_UINT16 statusReg;
     LEP_INT16 statusCode;
-    LEP_UINT32 done;
-    LEP_UINT16 timeoutCount = LEPTON_I2C_COMMAND_BUSY_WAIT_COUNT;
 
     /* Implement the Lepton TWI WRITE Protocol
     */
@@ -443,27 +688,14 @@ LEP_RESULT LEP_I2C_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
     ** command by polling the STATUS REGISTER BUSY Bit until it
     ** reports NOT BUSY.
     */ 
-    do
+    if( waitReady )
     {
-        /* Read the Status REGISTER and peek at the BUSY Bit
-        */ 
-        result = LEP_I2C_MasterReadRegister( portDescPtr->portID,
-                                             portDescPtr->deviceAddress,
-                                             LEP_I2C_STATUS_REG,
-                                             &statusReg);
+        result = LEP_I2C_WaitNotBusy( portDescPtr, &statusReg );
         if(result != LEP_OK)
         {
             return(result);
         }
-        done = (statusReg & LEP_I2C_STATUS_BUSY_BIT_MASK)? 0: 1;
-        /* Add timout check */
-        if( timeoutCount-- == 0 )
-        {
-            /* Timed out waiting for command busy to go away
-            */ 
-
-        }
-    }while( !done );
+    }
 
     if( result == LEP_OK )
     {
@@ -489,22 +721,11 @@ LEP_RESULT LEP_I2C_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
                 ** polling the statusReg REGISTER BUSY Bit until it reports NOT
                 ** BUSY.
                 */ 
-                do
+                result = LEP_I2C_WaitNotBusy( portDescPtr, &statusReg );
+                if(result != LEP_OK)
                 {
-                    /* Read the statusReg REGISTER and peek at the BUSY Bit
-                    */ 
-                    result = LEP_I2C_MasterReadRegister( portDescPtr->portID,
-                                                         portDescPtr->deviceAddress,
-                                                         LEP_I2C_STATUS_REG,
-                                                         &statusReg);
-                    if(result != LEP_OK)
-                    {
-                        return(result);
-                    }
-                    done = (statusReg & LEP_I2C_STATUS_BUSY_BIT_MASK)? 0: 1;
-                    /* Timeout? */
-
-                }while( !done );
+                    return(result);
+                }
 
                 statusCode = (statusReg >> 8) ? ((statusReg >> 8) | 0xFF00) : 0;
                 if(statusCode)
@@ -521,77 +742,3 @@ LEP_RESULT LEP_I2C_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
     
     return(result);
 }
-
-LEP_RESULT LEP_I2C_DirectReadRegister(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
-                                      LEP_UINT16 regAddress,
-                                      LEP_UINT16 *regValue)
-{
-   LEP_RESULT result = LEP_OK;
-
-   result = LEP_I2C_MasterReadRegister( portDescPtr->portID,
-                                        portDescPtr->deviceAddress,
-                                        regAddress,
-                                        regValue);
-
-   return(result);
-}
-
-LEP_RESULT LEP_I2C_GetPortStatus(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr)
-{
-    LEP_RESULT result = LEP_OK;
-
-    return(result);
-}
-
-LEP_RESULT LEP_I2C_GetDeviceAddress(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
-                                    LEP_UINT8* deviceAddress)
-{
-   LEP_RESULT result = LEP_OK;
-
-   if(deviceAddress == NULL)
-   {
-      return(LEP_BAD_ARG_POINTER_ERROR);
-   }
-   *deviceAddress = portDescPtr->deviceAddress;
-
-   return(result);
-}
-
-
-LEP_RESULT LEP_I2C_DirectWriteBuffer(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
-                                     LEP_ATTRIBUTE_T_PTR attributePtr,
-                                     LEP_UINT16 attributeWordLength)
-{
-   LEP_RESULT result = LEP_OK;
-
-   /* WRITE to the DATA Block Buffer
-   */     
-   result = LEP_I2C_MasterWriteData(portDescPtr->portID,
-                                    portDescPtr->deviceAddress,
-                                    LEP_I2C_DATA_BUFFER_0,
-                                    attributePtr,
-                                    attributeWordLength );
-
-  
-
-   return(result);
-}
-
-LEP_RESULT LEP_I2C_DirectWriteRegister(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
-                                       LEP_UINT16 regAddress,
-                                       LEP_UINT16 regValue)
-{
-   LEP_RESULT result = LEP_OK;
-
-   result = LEP_I2C_MasterWriteRegister(portDescPtr->portID,
-                                        portDescPtr->deviceAddress,
-                                        regAddress, 
-                                        regValue);
-   return(result);
-}
-
-/******************************************************************************/
-/** PRIVATE MODULE FUNCTIONS                                                 **/
-/******************************************************************************/
-
-
@@ -127,7 +127,7 @@ LEP_RESULT LEP_I2C_MasterClose(LEP_CAMERA_PORT_DESC_T_PTR portDescriptorPtr)
 
     /* Do any device-specific calls to implement a close operation
     */ 
-	result = DEV_I2C_MasterClose();
+	result = DEV_I2C_MasterClose( portDescriptorPtr->portID );
     return(result);
 }
 
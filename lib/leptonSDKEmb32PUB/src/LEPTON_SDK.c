@@ -232,6 +232,41 @@ LEP_RESULT LEP_RunCommand(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
     return(result);
 }
 
+/**
+ * Runs a batch of GET/SET/RUN commands back to back. Stops at the
+ * first failed command, see LEP_I2C_RunBatch.
+ * 
+ * @return LEP_OK, or the result of the failed command
+ */
+LEP_RESULT LEP_RunBatch(LEP_CAMERA_PORT_DESC_T_PTR portDescPtr,
+                        LEP_I2C_BATCH_ENTRY_T_PTR entries,
+                        LEP_UINT16 numEntries)
+{
+    LEP_RESULT  result = LEP_OK;
+
+    /* Validate the port descriptor
+    */ 
+    if( portDescPtr == NULL )
+    {
+        return(LEP_COMM_PORT_NOT_OPEN);
+    }
+
+    /* Perform Commands
+    */
+    if( portDescPtr->portType == LEP_CCI_TWI )
+    {
+        /* Use the Lepton TWI/CCI Port
+        */ 
+        result = LEP_I2C_RunBatch( portDescPtr,
+                                   entries,
+                                   numEntries );
+    }
+    else
+        result = LEP_COMM_INVALID_PORT_ERROR;
+
+    return(result);
+}
+
 
 /******************************************************************************/
 /**
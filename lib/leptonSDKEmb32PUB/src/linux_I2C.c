@@ -0,0 +1,301 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/******************************************************************************/
+/** Lepton Device-Specific Driver for the Linux i2c-dev interface            **/
+/** (/dev/i2c-N). Each register access is a single I2C_RDWR ioctl (register **/
+/** address write and data read combined, with a repeated start), so no     **/
+/** root access or /dev/mem mapping is needed: only access to the device.   **/
+/******************************************************************************/
+
+/******************************************************************************/
+/** INCLUDE FILES                                                            **/
+/******************************************************************************/
+
+#include "LEPTON_Types.h"
+#include "LEPTON_ErrorCodes.h"
+#include "raspi_I2C.h"
+#include "LEPTON_I2C_Reg.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/******************************************************************************/
+/** LOCAL DEFINES                                                            **/
+/******************************************************************************/
+
+/* Largest I2C transfer payload (CCI data block buffer), in 16-bit words */
+#define I2C_MAX_DATA_WORDS  (LEP_I2C_DATA_BUFFER_0_LENGTH >> 1)
+
+/* I2C buses that can be opened (/dev/i2c-0 ... /dev/i2c-15) */
+#define I2C_MAX_BUSES       16
+
+/******************************************************************************/
+/** PRIVATE DATA DECLARATIONS                                                **/
+/******************************************************************************/
+
+/* Open buses, by port ID. A bus shared by several ports is opened once, and
+   closed by the last port. Guarded by the LEP_I2C transaction lock. */
+static int busFd[I2C_MAX_BUSES] = {-1, -1, -1, -1, -1, -1, -1, -1,
+                                   -1, -1, -1, -1, -1, -1, -1, -1};
+static int busPorts[I2C_MAX_BUSES] = {0};
+
+/* Bus system calls, see DEV_I2C_SetBusOps */
+static int DEV_I2C_SysOpen(const char *path, int flags);
+static int DEV_I2C_SysIoctl(int fd, unsigned long request, void *arg);
+static const DEV_I2C_BUS_OPS_T sysBusOps = {DEV_I2C_SysOpen, DEV_I2C_SysIoctl, close};
+static const DEV_I2C_BUS_OPS_T *busOps = &sysBusOps;
+
+/******************************************************************************/
+/** PRIVATE FUNCTION DECLARATIONS                                            **/
+/******************************************************************************/
+
+static int DEV_I2C_Transfer(LEP_UINT16 portID, struct i2c_msg *msgs, int numMsgs);
+
+/******************************************************************************/
+/** EXPORTED PUBLIC FUNCTIONS                                                **/
+/******************************************************************************/
+
+/**
+ * Opens the I2C bus /dev/i2c-<portID>
+ * 
+ * @param portID     LEP_UINT16  I2C bus number
+ * 
+ * @param BaudRate   Clock speed in kHz. The i2c-dev bus speed is set by the
+ *                   kernel (e.g. dtparam=i2c_arm_baudrate on the Raspberry
+ *                   Pi), so it is left unchanged.
+ * 
+ * @return LEP_RESULT  0 if all goes well, errno otherwise
+ */
+LEP_RESULT DEV_I2C_MasterInit(LEP_UINT16 portID, 
+                              LEP_UINT16 *BaudRate)
+{
+    char path[32];
+    unsigned long funcs = 0;
+
+    if (portID >= I2C_MAX_BUSES) {
+        printf(" ERROR: Invalid I2C bus %u. \n", portID);
+        return LEP_COMM_INVALID_PORT_ERROR;
+    }
+
+    if (busPorts[portID] == 0) {
+        snprintf(path, sizeof(path), "/dev/i2c-%u", portID);
+        busFd[portID] = busOps->open(path, O_RDWR | O_CLOEXEC);
+        if (busFd[portID] < 0) {
+            printf(" ERROR: Unable to open %s: %s. \n", path, strerror(errno));
+            return LEP_ERROR;
+        }
+
+        // Register reads need combined (repeated start) transfers
+        if (busOps->ioctl(busFd[portID], I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C)) {
+            printf(" ERROR: %s does not support I2C_RDWR transfers. \n", path);
+            busOps->close(busFd[portID]);
+            busFd[portID] = -1;
+            return LEP_ERROR;
+        }
+    }
+    ++busPorts[portID];
+
+    return LEP_OK;
+}
+
+/**
+ * Closes the I2C bus, once all its ports are closed
+ * 
+ * @param portID     LEP_UINT16  I2C bus number
+ * 
+ * @return LEP_RESULT  0 if all goes well, errno otherwise.
+ */
+LEP_RESULT DEV_I2C_MasterClose(LEP_UINT16 portID)
+{
+    if (portID < I2C_MAX_BUSES && busPorts[portID] > 0 && --busPorts[portID] == 0) {
+        busOps->close(busFd[portID]);
+        busFd[portID] = -1;
+    }
+
+    return LEP_OK;
+}
+
+/**
+ * Resets the I2C driver back to the READY state.
+ * 
+ * @return LEP_RESULT  0 if all goes well, errno otherwise.
+ */
+LEP_RESULT DEV_I2C_MasterReset(void )
+{
+    return LEP_OK;
+}
+
+LEP_RESULT DEV_I2C_MasterReadData(LEP_UINT16  portID,               // I2C bus number
+                                  LEP_UINT8   deviceAddress,        // Lepton Camera I2C Device Address
+                                  LEP_UINT16  regAddress,           // Lepton Register Address
+                                  LEP_UINT16 *readDataPtr,          // Read DATA buffer pointer
+                                  LEP_UINT16  wordsToRead,          // Number of 16-bit words to Read
+                                  LEP_UINT16 *numWordsRead,         // Number of 16-bit words actually Read
+                                  LEP_UINT16 *status                // Transaction Status
+                                 )
+{
+    LEP_UINT16 txdata[1];
+    struct i2c_msg msgs[2];
+    LEP_UINT16 i;
+
+    *numWordsRead = 0;
+    if (wordsToRead > I2C_MAX_DATA_WORDS) {
+        return LEP_ERROR_I2C_BUFFER_OVERFLOW;
+    }
+
+    // Register address (big endian), then the data read straight into the
+    // caller buffer, in one combined transfer
+    txdata[0] = htobe16(regAddress);
+    msgs[0].addr = deviceAddress;
+    msgs[0].flags = 0;
+    msgs[0].len = sizeof(txdata);
+    msgs[0].buf = (LEP_UINT8 *)txdata;
+    msgs[1].addr = deviceAddress;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = (LEP_UINT16)(wordsToRead << 1);
+    msgs[1].buf = (LEP_UINT8 *)readDataPtr;
+    if (DEV_I2C_Transfer(portID, msgs, 2) < 0) {
+        return LEP_ERROR_I2C_FAIL;
+    }
+
+    // Words are sent big endian
+    for (i = 0; i < wordsToRead; ++i) {
+        readDataPtr[i] = be16toh(readDataPtr[i]);
+    }
+    *numWordsRead = wordsToRead;
+
+    return LEP_OK;
+}
+
+LEP_RESULT DEV_I2C_MasterWriteData(LEP_UINT16  portID,              // I2C bus number
+                                   LEP_UINT8   deviceAddress,       // Lepton Camera I2C Device Address
+                                   LEP_UINT16  regAddress,          // Lepton Register Address
+                                   LEP_UINT16 *writeDataPtr,        // Write DATA buffer pointer
+                                   LEP_UINT16  wordsToWrite,        // Number of 16-bit words to Write
+                                   LEP_UINT16 *numWordsWritten,     // Number of 16-bit words actually written
+                                   LEP_UINT16 *status)              // Transaction Status
+{
+    LEP_UINT16 txdata[1 + I2C_MAX_DATA_WORDS];
+    struct i2c_msg msg;
+    LEP_UINT16 i;
+
+    *numWordsWritten = 0;
+    if (wordsToWrite > I2C_MAX_DATA_WORDS) {
+        return LEP_ERROR_I2C_BUFFER_OVERFLOW;
+    }
+
+    // Register address and data, big endian, in one write
+    txdata[0] = htobe16(regAddress);
+    for (i = 0; i < wordsToWrite; ++i) {
+        txdata[1 + i] = htobe16(writeDataPtr[i]);
+    }
+    msg.addr = deviceAddress;
+    msg.flags = 0;
+    msg.len = (LEP_UINT16)((1 + wordsToWrite) << 1);
+    msg.buf = (LEP_UINT8 *)txdata;
+    if (DEV_I2C_Transfer(portID, &msg, 1) < 0) {
+        return LEP_ERROR;
+    }
+    *numWordsWritten = wordsToWrite;
+
+    return LEP_OK;
+}
+
+LEP_RESULT DEV_I2C_MasterReadRegister( LEP_UINT16 portID,
+                                       LEP_UINT8  deviceAddress, 
+                                       LEP_UINT16 regAddress,
+                                       LEP_UINT16 *regValue,
+                                       LEP_UINT16 *status
+                                     )
+{
+    LEP_UINT16 wordsActuallyRead;
+    return DEV_I2C_MasterReadData(portID, deviceAddress, regAddress, regValue, 1, &wordsActuallyRead, status);
+}
+
+LEP_RESULT DEV_I2C_MasterWriteRegister( LEP_UINT16 portID,
+                                        LEP_UINT8  deviceAddress, 
+                                        LEP_UINT16 regAddress,
+                                        LEP_UINT16 regValue,
+                                        LEP_UINT16 *status
+                                      )
+{
+    LEP_UINT16 wordsActuallyWritten;
+    return DEV_I2C_MasterWriteData(portID, deviceAddress, regAddress, &regValue, 1, &wordsActuallyWritten, status);
+}
+
+LEP_RESULT DEV_I2C_MasterStatus(void )
+{
+    return LEP_OK;
+}
+
+/**
+ * Replaces the bus system calls, e.g. by a fake bus master to check the
+ * driver without an I2C adapter. Set while no port is open.
+ * 
+ * @param ops        Bus open, ioctl and close calls, NULL for the system ones
+ */
+void DEV_I2C_SetBusOps(const DEV_I2C_BUS_OPS_T *ops)
+{
+    busOps = (ops != NULL)? ops: &sysBusOps;
+}
+
+/******************************************************************************/
+/** PRIVATE MODULE FUNCTIONS                                                 **/
+/******************************************************************************/
+
+/* Runs the messages as one combined transfer on the port bus
+*/
+static int DEV_I2C_Transfer(LEP_UINT16 portID, struct i2c_msg *msgs, int numMsgs)
+{
+    struct i2c_rdwr_ioctl_data transfer;
+
+    if (portID >= I2C_MAX_BUSES || busFd[portID] < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    transfer.msgs = msgs;
+    transfer.nmsgs = (__u32)numMsgs;
+    return busOps->ioctl(busFd[portID], I2C_RDWR, &transfer);
+}
+
+static int DEV_I2C_SysOpen(const char *path, int flags)
+{
+    return open(path, flags);
+}
+
+static int DEV_I2C_SysIoctl(int fd, unsigned long request, void *arg)
+{
+    return ioctl(fd, request, arg);
+}
@@ -78,6 +78,10 @@ const LEP_INT32 VALUE_SIZE_BYTES = 2;
 float clk_rate;
 const LEP_INT32 comm_timeout_ms = 500;
 
+/* Largest I2C transfer payload (CCI data block buffer), in 16-bit words.
+   Transfers use stack buffers of this size, no heap allocation. */
+#define I2C_MAX_DATA_WORDS  (LEP_I2C_DATA_BUFFER_0_LENGTH >> 1)
+
 /******************************************************************************/
 /** LOCAL TYPE DEFINITIONS                                                   **/
 /******************************************************************************/
@@ -86,6 +90,13 @@ const LEP_INT32 comm_timeout_ms = 500;
 /** PRIVATE DATA DECLARATIONS                                                **/
 /******************************************************************************/
 
+/* Opens of the bcm2835 I2C master (one per camera). The master is set up by
+   the first open, and released by the last close. bcm2835 drives one bus
+   (BSC1) whatever the port ID, so every open must use the same port ID as
+   the first one. Guarded by the LEP_I2C transaction lock. */
+static int openPorts = 0;
+static LEP_UINT16 openPortID = 0;
+
 /******************************************************************************/
 /** PRIVATE FUNCTION DECLARATIONS                                            **/
 /******************************************************************************/
@@ -103,8 +114,10 @@ const LEP_INT32 comm_timeout_ms = 500;
 /**
  * Performs I2C Master Initialization
  * 
- * @param portID     LEP_UINT16  User specified port ID tag.  Can be used to
- *                   select between multiple cameras
+ * @param portID     LEP_UINT16  User specified port ID tag. bcm2835 drives
+ *                   a single I2C bus, a port ID other than the one already
+ *                   open is rejected (use the i2c-dev backend for several
+ *                   cameras)
  * 
  * @param BaudRate   Clock speed in kHz. Typically this is 400.
  *                   The Device Specific Driver will try to match the desired
@@ -116,13 +129,24 @@ const LEP_INT32 comm_timeout_ms = 500;
 LEP_RESULT DEV_I2C_MasterInit(LEP_UINT16 portID, 
                               LEP_UINT16 *BaudRate)
 {
+    // Only one bus, shared by every open of the same port
+    if (openPorts > 0 && portID != openPortID) {
+        printf(" ERROR: bcm2835 I2C master already open on port %u, can't open port %u. \n",
+               openPortID, portID);
+        return LEP_COMM_INVALID_PORT_ERROR;
+    }
+
     // Init bcm2835 lib for I2C communication
-    if (!bcm2835_init()) {
-        printf(" ERROR: Unable to init bcm2835. \n");
-        return LEP_ERROR;
+    if (openPorts == 0) {
+        if (!bcm2835_init()) {
+            printf(" ERROR: Unable to init bcm2835. \n");
+            return LEP_ERROR;
+        }
+        bcm2835_i2c_begin();
+        bcm2835_i2c_set_baudrate(100000);
+        openPortID = portID;
     }
-    bcm2835_i2c_begin();
-    bcm2835_i2c_set_baudrate(100000);
+    ++openPorts;
 
     return LEP_OK;
 }
@@ -130,13 +154,17 @@ LEP_RESULT DEV_I2C_MasterInit(LEP_UINT16 portID,
 /**
  * Closes the I2C driver connection.
  * 
+ * @param portID     LEP_UINT16  Port ID tag, given at init
+ * 
  * @return LEP_RESULT  0 if all goes well, errno otherwise.
  */
-LEP_RESULT DEV_I2C_MasterClose()
+LEP_RESULT DEV_I2C_MasterClose(LEP_UINT16 portID)
 {
     // Close bcm2835 communication
-    bcm2835_i2c_end();
-    bcm2835_close();
+    if (openPorts > 0 && --openPorts == 0) {
+        bcm2835_i2c_end();
+        bcm2835_close();
+    }
 
     return LEP_OK;
 }
@@ -176,12 +204,18 @@ LEP_RESULT DEV_I2C_MasterReadData(LEP_UINT16  portID,               // User-defi
    LEP_UINT16 bytesActuallyWritten = 0;
    LEP_UINT16 bytesActuallyRead = 0;
    LEP_UINT16 wordsActuallyRead = 0;
-   LEP_UINT8* txdata = (LEP_UINT8*)malloc(sizeof(LEP_UINT8)*ADDRESS_SIZE_BYTES);
-   LEP_UINT8* rxdata = (LEP_UINT8*)malloc(sizeof(LEP_UINT8)*bytesToRead);
+   LEP_UINT16 txdata[1];
+   LEP_UINT16 rxdata[I2C_MAX_DATA_WORDS];
    LEP_UINT16 *dataPtr;
    LEP_UINT16 *writePtr;
 
-   *(LEP_UINT16*)txdata = REVERSE_ENDIENESS_UINT16(regAddress);
+   if(wordsToRead > I2C_MAX_DATA_WORDS)
+   {
+      *numWordsRead = 0;
+      return(LEP_ERROR_I2C_BUFFER_OVERFLOW);
+   }
+
+   txdata[0] = REVERSE_ENDIENESS_UINT16(regAddress);
 
     bcm2835_i2c_setSlaveAddress(deviceAddress);
     if (BCM2835_I2C_REASON_OK ==
@@ -216,14 +250,12 @@ LEP_RESULT DEV_I2C_MasterReadData(LEP_UINT16  portID,               // User-defi
    wordsActuallyRead = (LEP_UINT16)(bytesActuallyRead >> 1);
    *numWordsRead = wordsActuallyRead;
 
-   dataPtr = (LEP_UINT16*)&rxdata[0];
+   dataPtr = &rxdata[0];
    writePtr = readDataPtr;
    while(wordsActuallyRead--){
       *writePtr++ = REVERSE_ENDIENESS_UINT16(*dataPtr);
       dataPtr++;
    }
-   free(txdata);
-   free(rxdata);
 
    LEP_UINT8* byteData = (LEP_UINT8*)readDataPtr;
 
@@ -256,13 +288,19 @@ LEP_RESULT DEV_I2C_MasterWriteData(LEP_UINT16  portID,              // User-defi
    LEP_INT16 bytesOfDataToWrite = (wordsToWrite << 1);
    LEP_INT16 bytesToWrite = bytesOfDataToWrite + ADDRESS_SIZE_BYTES;
    LEP_INT16 bytesActuallyWritten = 0;
-   LEP_UINT8* txdata = (LEP_UINT8*)malloc(sizeof(LEP_UINT8)*(int)bytesToWrite);
+   LEP_UINT16 txdata[1 + I2C_MAX_DATA_WORDS];
    LEP_UINT16 *dataPtr;
    LEP_UINT16 *txPtr;
 
-   *(LEP_UINT16*)txdata = REVERSE_ENDIENESS_UINT16(regAddress);
+   if(wordsToWrite > I2C_MAX_DATA_WORDS)
+   {
+      *numWordsWritten = 0;
+      return(LEP_ERROR_I2C_BUFFER_OVERFLOW);
+   }
+
+   txdata[0] = REVERSE_ENDIENESS_UINT16(regAddress);
    dataPtr = (LEP_UINT16*)&writeDataPtr[0];
-   txPtr = (LEP_UINT16*)&txdata[ADDRESS_SIZE_BYTES]; //Don't overwrite the address bytes
+   txPtr = &txdata[1]; //Don't overwrite the address bytes
    while(wordsToWrite--){
       *txPtr++ = (LEP_UINT16)REVERSE_ENDIENESS_UINT16(*dataPtr);
       dataPtr++;
@@ -292,7 +330,6 @@ LEP_RESULT DEV_I2C_MasterWriteData(LEP_UINT16  portID,              // User-defi
    *numWordsWritten = (bytesActuallyWritten >> 1);
 
    result = (LEP_RESULT)raspi_result;
-   free(txdata);
 
    if(raspi_result != 0 || bytesActuallyWritten != bytesToWrite)
    {
@@ -32,8 +32,9 @@
 
 // C/C++
 #include <cstring>
+#include <string>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <iostream>
 
 /**
@@ -68,42 +69,150 @@ bool ConnectPublisher(int port_number,
                       int& socketHandle);
 
 /**
- * @brief Receive a message from the connected socket
- * @tparam T            Message type
+ * @brief Receive exactly size bytes from the connected socket. Partial reads
+ *        are completed, and interrupted calls are resumed.
  * @param socketHandle  Socket connection address
- * @param msg           Receive message
+ * @param data          Destination buffer
+ * @param size          Number of bytes to receive
+ * @param timeout_ms    Max wait time for the whole data in milliseconds (-1
+ *                      waits forever). On timeout the bytes already received
+ *                      are lost, so the connection should be closed.
+ * @return True, if all the data was received, false on timeout
+ * @throw Runtime error if the connection is closed or lost
  */
-template <typename T>
-inline void ReceiveMessage(int socketHandle,
-                           T& msg) {
+bool ReceiveData(int socketHandle, void* data, size_t size, int timeout_ms = -1);
 
-    size_t data_size{0};
-    do
-    { // wait for data to be available
-        ioctl(socketHandle, FIONREAD, &data_size);
-    } while (data_size < sizeof(T));
-    auto rc = recv(socketHandle, &msg, sizeof(T), 0);
+/**
+ * @brief Send the data parts to the connected socket, in order. Partial writes
+ *        are completed, and interrupted calls are resumed.
+ * @param socketHandle  Socket connection address
+ * @param parts         Data parts (updated while sending)
+ * @param num_parts     Number of data parts
+ * @param timeout_ms    Max wait time for the whole data in milliseconds (-1
+ *                      waits forever). On timeout part of the data may be
+ *                      sent already, so the connection should be closed.
+ * @return True, if all the data was sent, false on timeout
+ * @throw Runtime error if the connection is closed or lost
+ */
+bool SendData(int socketHandle, iovec* parts, int num_parts, int timeout_ms = -1);
 
-    // Check if connection is still open
-    if (rc == -1) {
-        std::cerr << "Error: " << strerror(errno) << std::endl;
-        throw std::runtime_error("Connection lost.");
-    }
-}
+//------------------------------ Wire format ----------------------------------//
+// Messages are sent as a fixed size big endian header followed by a payload,
+// see ConnectionCommon.h. The encoders write a WireMessage, ready to be sent;
+// the decoders validate it (magic, version, payload size).
+
+/**
+ * @brief Validate a message header, and read its payload length
+ * @param header          Header bytes (kWireHeaderSize bytes)
+ * @param payload_length  Payload length in bytes
+ * @return True, if the header is valid (known magic and version, payload not
+ *         larger than kMaxPayloadSize, frame not larger than kMaxWidth x
+ *         kMaxHeight x kMaxBytesPerPixel), false otherwise
+ */
+bool DecodeWireHeader(const uint8_t* header, uint32_t& payload_length);
+
+/**
+ * @brief Encode a request (requests have no payload)
+ */
+void EncodeRequest(const RequestMessage& msg, WireMessage& wire);
+
+/**
+ * @brief Decode a request
+ * @return True, if the request is valid, false otherwise
+ */
+bool DecodeRequest(const WireMessage& wire, RequestMessage& msg);
+
+/**
+ * @brief Encode a response header. The caller writes the payload_length bytes
+ *        of payload at the returned address (e.g. a frame scaled in place).
+ * @param msg             Response fields (the frame content is ignored)
+ * @param payload_length  Payload length in bytes (at most kMaxPayloadSize)
+ * @param wire            Encoded message, sized for the header and payload
+ * @return Payload address in the encoded message
+ */
+uint8_t* EncodeResponseHeader(const ResponseHeader& msg,
+                              uint32_t payload_length,
+                              WireMessage& wire);
+
+/**
+ * @brief Encode a response without payload (e.g. no frame, resend)
+ */
+void EncodeStatusResponse(RequestType type, RequestStatus status, WireMessage& wire);
+
+/**
+ * @brief Encode a response. Frames carry width * height * bpp bytes of the
+ *        message frame (U16 pixels in big endian), successful I2C responses
+ *        carry the 4 bytes command result, other responses have no payload.
+ */
+void EncodeResponse(const ResponseMessage& msg, WireMessage& wire);
 
 /**
- * @brief Send a message to the connected socket
- * @tparam T            Message type
+ * @brief Decode a response, the frame pixels are stored in host byte order
+ *        (compressed frames are decompressed)
+ * @return True, if the response is valid (frames of 1 or 2 bytes per pixel,
+ *         with a payload matching their size), false otherwise
+ */
+bool DecodeResponse(const WireMessage& wire, ResponseMessage& msg);
+
+/**
+ * @brief Encode a U16 frame response, losslessly compressed
+ * @param msg     Response fields (the encoding is set by the function)
+ * @param pixels  Frame pixels (msg.width * msg.height)
+ * @param wire    Encoded message
+ * @return True, if the frame was encoded, false if it does not compress (send
+ *         it uncompressed instead)
+ */
+bool EncodeFrameU16(const ResponseHeader& msg, const uint16_t* pixels, WireMessage& wire);
+
+/**
+ * @brief Write U16 pixels in big endian byte order
+ * @param pixels      Source pixels
+ * @param num_pixels  Number of pixels
+ * @param payload     Destination (2 * num_pixels bytes)
+ */
+void EncodePixelsU16(const uint16_t* pixels, size_t num_pixels, uint8_t* payload);
+
+/**
+ * @brief Send an encoded message to the connected socket
+ * @param socketHandle  Socket connection address
+ * @param wire          Encoded message
+ * @param timeout_ms    Max wait time in milliseconds (-1 waits forever)
+ * @return True, if the message was sent, false on timeout
+ * @throw Runtime error if the connection is closed or lost
+ */
+bool SendWire(int socketHandle, const WireMessage& wire, int timeout_ms = -1);
+
+/**
+ * @brief Receive an encoded message (header, then payload) from the connected
+ *        socket
+ * @param socketHandle  Socket connection address
+ * @param wire          Received message
+ * @param timeout_ms    Max wait time in milliseconds (-1 waits forever)
+ * @return True, if the message was received, false on timeout
+ * @throw Runtime error if the connection is closed or lost, or the message
+ *        header is invalid (e.g. a peer using a different protocol version)
+ */
+bool ReceiveWire(int socketHandle, WireMessage& wire, int timeout_ms = -1);
+
+/**
+ * @brief Send a request/response to the connected socket, in wire format
  * @param socketHandle  Socket connection address
  * @param msg           Message content
+ * @param timeout_ms    Max wait time in milliseconds (-1 waits forever)
+ * @return True, if the message was sent, false on timeout
+ * @throw Runtime error if the connection is closed or lost
  */
-template <typename T>
-inline void SendMessage(int socketHandle,
-                        T& msg) {
+bool SendMessage(int socketHandle, const RequestMessage& msg, int timeout_ms = -1);
+bool SendMessage(int socketHandle, const ResponseMessage& msg, int timeout_ms = -1);
 
-    auto sd = send(socketHandle, &msg, sizeof(T), 0);
-    if (sd == -1) {
-        std::cerr << "Error: " << strerror(errno) << std::endl;
-        throw std::runtime_error("Connection lost.");
-    }
-}
\ No newline at end of file
+/**
+ * @brief Receive a request/response from the connected socket, in wire format
+ * @param socketHandle  Socket connection address
+ * @param msg           Received message
+ * @param timeout_ms    Max wait time in milliseconds (-1 waits forever)
+ * @return True, if the message was received, false on timeout
+ * @throw Runtime error if the connection is closed or lost, or the message
+ *        is invalid
+ */
+bool ReceiveMessage(int socketHandle, RequestMessage& msg, int timeout_ms = -1);
+bool ReceiveMessage(int socketHandle, ResponseMessage& msg, int timeout_ms = -1);
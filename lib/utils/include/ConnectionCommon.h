@@ -40,6 +40,9 @@ enum RequestType {
     REQUEST_FRAME,   // Request a frame
     REQUEST_I2C,     // Request an I2C command
     REQUEST_EXIT,    // Request app exit
+    REQUEST_SUBSCRIBE,   // Subscribe to the frame stream, the server pushes each new frame
+    REQUEST_UNSUBSCRIBE, // Stop the frame stream
+    REQUEST_CREDIT,      // Allow the server to push more frames (flow control)
     REQUEST_UNKNOWN  // Unknown request
 };
 
@@ -51,7 +54,16 @@ enum RequestCmd {
     // I2C request cmd
     CMD_I2C_FFC,
     CMD_I2C_SENSOR_TEMPERATURE,
-    CMD_VOID
+    CMD_VOID,
+    // Frame request cmd, U16 frame losslessly compressed (see FrameCodec.h).
+    // Added last, the I2C cmd values match LeptonI2CCmd
+    CMD_FRAME_U16_COMPRESSED
+};
+
+// Response frame payload encoding
+enum FrameEncoding {
+    ENCODING_RAW,       // Pixels as is (U16 big endian)
+    ENCODING_LOSSLESS   // U16 frame compressed by CompressFrameU16
 };
 
 // Request message status
@@ -67,16 +79,56 @@ enum RequestStatus {
 struct RequestMessage {
     RequestType req_type{REQUEST_UNKNOWN};
     RequestCmd req_cmd{CMD_VOID};
+    uint32_t credits{0};    // Subscribe/credit: frames the server may push (subscribe with 0 = no flow control)
 };
 
-// Publisher uses this message in response to the subscriber request
-struct ResponseMessage {
+// Publisher response fields, without the frame
+struct ResponseHeader {
     RequestType req_type{REQUEST_UNKNOWN};
     RequestStatus req_status{STATUS_RESEND};
     uint32_t width{0};
     uint32_t height{0};
     uint32_t bpp{0};
     uint64_t frame_id{0};
+    double sensor_temperature{0.0};     // Kelvin scaled by 100
+    FrameEncoding encoding{ENCODING_RAW};
+};
+
+// Publisher uses this message in response to the subscriber request
+struct ResponseMessage : ResponseHeader {
     char frame[kMaxWidth * kMaxHeight * kMaxBytesPerPixel];
-    double sensor_temperature{0.0};
+};
+
+
+// Wire format: each message is sent as a fixed size header, followed by
+// payload_length bytes of payload. The header fields are big endian (network
+// byte order) at fixed offsets, with no padding, and so are the U16 frame
+// pixels, so client and server may run on different architectures.
+//
+//  offset  size  field
+//  0       2     magic (kWireMagic)
+//  2       1     version (kWireVersion)
+//  3       1     message type (RequestType)
+//  4       1     request: command (RequestCmd), response: status (RequestStatus)
+//  5       1     bytes per pixel
+//  6       2     frame width
+//  8       2     frame height
+//  10      2     frame payload encoding (FrameEncoding)
+//  12      4     credits (requests)
+//  16      8     frame id
+//  24      4     sensor temperature in Kelvin, scaled by 100
+//  28      4     payload length in bytes
+//
+// Payload: response frames carry width * height * bpp bytes (or less, when
+// compressed: the client asks for it, see CMD_FRAME_U16_COMPRESSED), I2C responses
+// carry the 4 bytes command result (if any), requests have no payload.
+constexpr uint16_t kWireMagic{0x4C50};  // "LP"
+constexpr uint8_t kWireVersion{1};
+constexpr size_t kWireHeaderSize{32};
+constexpr size_t kMaxPayloadSize{kMaxWidth * kMaxHeight * kMaxBytesPerPixel};
+
+// Encoded message (header + payload), as sent over the socket
+struct WireMessage {
+    size_t size{0};     // Header + payload size in bytes
+    uint8_t data[kWireHeaderSize + kMaxPayloadSize];
 };
@@ -0,0 +1,70 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+// C/C++
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief Lossless compression of a U16 frame. Each pixel is predicted from its
+ *        left, upper and upper-left neighbours (LOCO-I median predictor), and
+ *        the prediction residual is Rice coded, with the Rice parameter adapted
+ *        to the running mean of the residuals. Frames are coded on their own
+ *        (no reference to the previous frame), so one compressed frame can be
+ *        sent to many clients, and a lost frame does not break the next ones.
+ * @param pixels    Frame pixels
+ * @param width     Frame width
+ * @param height    Frame height
+ * @param data      Compressed frame
+ * @param capacity  Compressed frame buffer size in bytes
+ * @return Compressed frame size in bytes, 0 if it does not fit the capacity
+ *         (e.g. a noisy frame, send it uncompressed)
+ */
+size_t CompressFrameU16(const uint16_t* pixels,
+                        uint32_t width,
+                        uint32_t height,
+                        uint8_t* data,
+                        size_t capacity);
+
+/**
+ * @brief Decompress a frame compressed by CompressFrameU16
+ * @param data    Compressed frame
+ * @param size    Compressed frame size in bytes
+ * @param width   Frame width
+ * @param height  Frame height
+ * @param pixels  Frame pixels (width * height)
+ * @return True, if the frame was decoded, false if the data is corrupted
+ */
+bool DecompressFrameU16(const uint8_t* data,
+                        size_t size,
+                        uint32_t width,
+                        uint32_t height,
+                        uint16_t* pixels);
@@ -0,0 +1,107 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// LePi
+#include <ConnectionCommon.h>
+#include <LeptonCamera.h>
+#include <MessageServer.h>
+
+// C/C++
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief Serves the camera frames to the MessageServer clients. Clients either
+ *        request each frame (answered with the next frame, or with no frame
+ *        after the frame timeout), or subscribe and get each new frame pushed
+ *        (optionally limited by the credits they grant, so a slow client is
+ *        not flooded). Each new frame is leased once, and encoded once per
+ *        requested format (U8, U16, U16 compressed) into a pooled server
+ *        response fanned out to all the clients asking for it, so publishing
+ *        does not allocate.
+ */
+class FramePublisher {
+public:
+
+    /**
+     * @brief Frame publisher constructor
+     * @param server         Server the responses are sent through
+     * @param camera         Camera the frames are leased from
+     * @param frame_timeout  Max wait time for a frame request
+     */
+    FramePublisher(MessageServer& server, LeptonCamera& camera,
+                   std::chrono::milliseconds frame_timeout);
+    FramePublisher(FramePublisher const&) = delete;
+    FramePublisher& operator =(FramePublisher const&) = delete;
+
+    /**
+     * @brief Handle a client frame request (REQUEST_FRAME, REQUEST_SUBSCRIBE,
+     *        REQUEST_UNSUBSCRIBE or REQUEST_CREDIT)
+     * @return True, if the request was handled, false if it is not a frame
+     *         request
+     */
+    bool HandleRequest(int client, const RequestMessage& request);
+
+    /**
+     * @brief Forget a client requests (e.g. on disconnect)
+     */
+    void RemoveClient(int client);
+
+    /**
+     * @brief Send the new frame to the waiting clients and to the subscribers
+     *        with credits left. Call it when the camera frame eventfd is
+     *        readable (the event is cleared).
+     * @return Number of clients the frame was sent to
+     */
+    size_t Publish();
+
+    /**
+     * @brief Answer the frame requests waiting for longer than the frame
+     *        timeout with STATUS_NO_FRAME
+     */
+    void Expire();
+
+private:
+    // Client frame requests
+    struct FrameRequest {
+        bool waiting{false};
+        RequestCmd cmd{CMD_FRAME_U8};
+        std::chrono::steady_clock::time_point time;
+        bool subscribed{false};
+        bool flow_control{false};
+        uint32_t credits{0};
+    };
+
+    MessageServer& server_;
+    LeptonCamera& camera_;
+    std::chrono::milliseconds frame_timeout_;
+    std::vector<FrameRequest> requests_;
+};
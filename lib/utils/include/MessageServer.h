@@ -0,0 +1,219 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// LePi
+#include <ConnectionCommon.h>
+
+// C/C++
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include <sys/epoll.h>
+
+
+/**
+ * @brief Single threaded, epoll based TCP server for wire format messages
+ *        (header and payload, see ConnectionCommon.h). Accepts many clients,
+ *        reads their requests without blocking (partial reads are completed
+ *        on later events), and sends the responses from a bounded queue per
+ *        client. A client sending an invalid header is disconnected.
+ *
+ *        Responses come from a pool allocated once, and are reference counted:
+ *        one response can be queued for many clients (e.g. a frame fanned out
+ *        to all the subscribers) and returns to the pool once sent to all of
+ *        them. When a client queue is full, the oldest response not being sent
+ *        yet is dropped, so a slow client never stalls the server or the
+ *        other clients.
+ *
+ *        Besides the sockets, the server can watch other file descriptors
+ *        (e.g. the camera frame eventfd), reported through the event handler.
+ */
+class MessageServer {
+public:
+    using RequestHandler = std::function<void(int client, const WireMessage& request)>;
+    using ClientHandler = std::function<void(int client)>;
+    using EventHandler = std::function<void(int fd)>;
+
+    /**
+     * @brief Message server constructor
+     * @param max_clients  Max number of connected clients, the extra
+     *                     connections are closed as soon as accepted
+     * @param queue_size   Max number of responses queued per client
+     * @throw Runtime error when the epoll instance can't be created
+     */
+    MessageServer(size_t max_clients, size_t queue_size);
+    MessageServer(MessageServer const&) = delete;
+    MessageServer& operator =(MessageServer const&) = delete;
+    virtual ~MessageServer();
+
+    /**
+     * @brief Listen for client connections on all the addresses
+     * @param port_number  Server port number
+     * @return True, if the server listens, false otherwise
+     */
+    bool Listen(int port_number);
+
+    /**
+     * @brief Watch a file descriptor, reported through the event handler when
+     *        readable (the handler must clear the event)
+     * @param fd  File descriptor
+     * @return True, if the descriptor is watched, false otherwise
+     */
+    bool Watch(int fd);
+
+    /**
+     * @brief Event handlers (called from Poll)
+     */
+    void OnRequest(RequestHandler handler) { on_request_ = handler; }
+    void OnDisconnect(ClientHandler handler) { on_disconnect_ = handler; }
+    void OnEvent(EventHandler handler) { on_event_ = handler; }
+
+    /**
+     * @brief Wait for events, and handle them: accept new clients, read the
+     *        requests, send the queued responses, report the watched events
+     * @param timeout_ms  Max wait time in milliseconds (-1 waits forever)
+     * @return Number of events handled, -1 on error
+     */
+    int Poll(int timeout_ms);
+
+    /**
+     * @brief Take a response from the pool. The caller holds one reference,
+     *        released with Release once the response was sent to the clients.
+     *        Responses are not cleared between uses, the caller encodes them.
+     * @return Response, or nullptr if all the responses are in use
+     */
+    WireMessage* NewMessage();
+
+    /**
+     * @brief Release the caller reference to a response
+     */
+    void Release(WireMessage* msg);
+
+    /**
+     * @brief Queue a response for a client, and start sending it. If the client
+     *        queue is full, its oldest response not being sent is dropped.
+     * @param client  Client id
+     * @param msg     Response, taken from NewMessage
+     * @return True, if the response was queued without dropping another one,
+     *         false otherwise
+     */
+    bool Send(int client, WireMessage* msg);
+
+    /**
+     * @brief Close a client connection (its queued responses are dropped)
+     */
+    void Disconnect(int client);
+
+    /**
+     * @brief Server info
+     */
+    inline size_t MaxClients() const { return clients_.size(); }
+    inline bool Connected(int client) const { return clients_[client].fd >= 0; }
+    inline size_t Queued(int client) const { return clients_[client].queue.size(); }
+    inline uint64_t Dropped() const { return dropped_; }
+
+private:
+    // Pool slot: response and number of references (caller and client queues)
+    struct Slot {
+        WireMessage msg;
+        unsigned int refs{0};
+    };
+    static_assert(std::is_standard_layout<Slot>::value, "Slot must be a standard layout type");
+
+    // Connected client: partial request, and queue of responses to send
+    struct Client {
+        int fd{-1};
+        WireMessage request;
+        size_t received{0};     // request bytes received
+        uint32_t payload_length{0};  // request payload length, once the header is received
+        std::vector<Slot*> queue;
+        size_t sent{0};         // queue head bytes sent
+        bool writing{false};    // waiting for the socket to be writable
+    };
+
+    // Epoll event keys: client id, listening socket, or watched fd
+    static constexpr uint32_t kListenKey{0x40000000};
+    static constexpr uint32_t kWatchKey{0x80000000};
+    static constexpr size_t kSpareMessages{4};
+    static constexpr size_t kSpareEvents{8};
+
+    static Slot* ToSlot(WireMessage* msg) {
+        return reinterpret_cast<Slot*>(msg);
+    }
+
+    /**
+     * @brief Drop a reference to a response, back to the pool with the last one
+     */
+    void Unref(Slot* slot);
+
+    /**
+     * @brief Add a descriptor to the epoll set, tagged with its event key
+     */
+    bool AddFd(int fd, uint32_t events, uint32_t key);
+
+    /**
+     * @brief Watch (or stop watching) a client socket for writability
+     */
+    void SetWriting(int client, bool writing);
+
+    /**
+     * @brief Accept the pending connections, while client slots are free
+     */
+    void Accept();
+
+    /**
+     * @brief Read a client requests, and hand the complete ones to the handler
+     */
+    void Receive(int client);
+
+    /**
+     * @brief Send a client queued responses, until the socket would block
+     */
+    void Flush(int client);
+
+    /**
+     * @brief Close a client socket, and drop its queued responses
+     */
+    void CloseClient(int client);
+
+    int epoll_fd_{-1};
+    int listen_fd_{-1};
+    std::vector<epoll_event> events_;
+    std::vector<Client> clients_;
+    std::vector<Slot> slots_;
+    std::vector<Slot*> free_slots_;
+    size_t queue_size_;
+    uint64_t dropped_{0};
+
+    RequestHandler on_request_;
+    ClientHandler on_disconnect_;
+    EventHandler on_event_;
+};
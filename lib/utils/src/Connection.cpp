@@ -27,6 +27,7 @@
 
 // LePi
 #include <Connection.h>
+#include <FrameCodec.h>
 
 // C/C++
 #include <stdio.h>
@@ -41,6 +42,10 @@
 #include <errno.h>
 #include <ifaddrs.h>
 #include <arpa/inet.h>
+#include <poll.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 
 void GetIP (std::string& ipV4, std::string& ipV6) {
     
@@ -194,3 +199,388 @@ bool ConnectPublisher(int port_number,
     close(socketHandle);
     return true;
 }
+
+/**
+ * @brief Wait until the socket is ready for the given events, or the deadline
+ * @return True, if the socket is ready, false on timeout
+ */
+static bool WaitSocket(int socketHandle,
+                       short events,
+                       int timeout_ms,
+                       std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        int wait_ms{-1};
+        if (timeout_ms >= 0) {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            wait_ms = remaining > 0 ? static_cast<int>(remaining) : 0;
+        }
+        pollfd socket_poll{socketHandle, events, 0};
+        const int rc{poll(&socket_poll, 1, wait_ms)};
+        if (rc > 0) {
+            return true;    // ready, or error/hang up reported by the next call
+        }
+        if (rc == 0) {
+            return false;   // timeout
+        }
+        if (errno != EINTR) {
+            std::cerr << "Error: " << strerror(errno) << std::endl;
+            throw std::runtime_error("Connection lost.");
+        }
+    }
+}
+
+bool ReceiveData(int socketHandle, void* data, size_t size, int timeout_ms) {
+
+    auto buffer = static_cast<char*>(data);
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(timeout_ms);
+    size_t received{0};
+    while (received < size) {
+        if (!WaitSocket(socketHandle, POLLIN, timeout_ms, deadline)) {
+            return false;
+        }
+        const ssize_t rc{recv(socketHandle, buffer + received, size - received, 0)};
+        if (rc < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            std::cerr << "Error: " << strerror(errno) << std::endl;
+            throw std::runtime_error("Connection lost.");
+        }
+        if (rc == 0) {
+            std::cerr << "Error: connection closed by peer" << std::endl;
+            throw std::runtime_error("Connection lost.");
+        }
+        received += static_cast<size_t>(rc);
+    }
+    return true;
+}
+
+bool SendData(int socketHandle, iovec* parts, int num_parts, int timeout_ms) {
+
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(timeout_ms);
+    msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = parts;
+    header.msg_iovlen = num_parts;
+    while (header.msg_iovlen > 0) {
+
+        // Skip the parts already sent
+        if (header.msg_iov->iov_len == 0) {
+            ++header.msg_iov;
+            --header.msg_iovlen;
+            continue;
+        }
+
+        if (!WaitSocket(socketHandle, POLLOUT, timeout_ms, deadline)) {
+            return false;
+        }
+        ssize_t sd{sendmsg(socketHandle, &header, MSG_NOSIGNAL)};
+        if (sd < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            std::cerr << "Error: " << strerror(errno) << std::endl;
+            throw std::runtime_error("Connection lost.");
+        }
+
+        // Partial write: move past the bytes sent
+        for (; sd > 0 && header.msg_iovlen > 0; ++header.msg_iov, --header.msg_iovlen) {
+            const size_t part_sent{std::min(static_cast<size_t>(sd), header.msg_iov->iov_len)};
+            header.msg_iov->iov_base = static_cast<char*>(header.msg_iov->iov_base) + part_sent;
+            header.msg_iov->iov_len -= part_sent;
+            sd -= static_cast<ssize_t>(part_sent);
+            if (header.msg_iov->iov_len > 0) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+//------------------------------ Wire format ----------------------------------//
+
+// Header field offsets, see ConnectionCommon.h
+constexpr size_t kMagicOffset{0};
+constexpr size_t kVersionOffset{2};
+constexpr size_t kTypeOffset{3};
+constexpr size_t kCodeOffset{4};
+constexpr size_t kBppOffset{5};
+constexpr size_t kWidthOffset{6};
+constexpr size_t kHeightOffset{8};
+constexpr size_t kEncodingOffset{10};
+constexpr size_t kCreditsOffset{12};
+constexpr size_t kFrameIdOffset{16};
+constexpr size_t kTemperatureOffset{24};
+constexpr size_t kPayloadLengthOffset{28};
+
+// I2C command result size (one 32 bits value)
+constexpr uint32_t kI2CPayloadSize{4};
+
+static void Put16(uint8_t* data, uint16_t value) {
+    data[0] = static_cast<uint8_t>(value >> 8);
+    data[1] = static_cast<uint8_t>(value);
+}
+
+static void Put32(uint8_t* data, uint32_t value) {
+    Put16(data, static_cast<uint16_t>(value >> 16));
+    Put16(data + 2, static_cast<uint16_t>(value));
+}
+
+static void Put64(uint8_t* data, uint64_t value) {
+    Put32(data, static_cast<uint32_t>(value >> 32));
+    Put32(data + 4, static_cast<uint32_t>(value));
+}
+
+static uint16_t Get16(const uint8_t* data) {
+    return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+static uint32_t Get32(const uint8_t* data) {
+    return (static_cast<uint32_t>(Get16(data)) << 16) | Get16(data + 2);
+}
+
+static uint64_t Get64(const uint8_t* data) {
+    return (static_cast<uint64_t>(Get32(data)) << 32) | Get32(data + 4);
+}
+
+/**
+ * @brief Write the header fields shared by requests and responses
+ */
+static void EncodeHeader(uint8_t type, uint8_t code, uint32_t payload_length, uint8_t* header) {
+    memset(header, 0, kWireHeaderSize);
+    Put16(header + kMagicOffset, kWireMagic);
+    header[kVersionOffset] = kWireVersion;
+    header[kTypeOffset] = type;
+    header[kCodeOffset] = code;
+    Put32(header + kPayloadLengthOffset, payload_length);
+}
+
+bool DecodeWireHeader(const uint8_t* header, uint32_t& payload_length) {
+    payload_length = Get32(header + kPayloadLengthOffset);
+    return Get16(header + kMagicOffset) == kWireMagic &&
+           header[kVersionOffset] == kWireVersion &&
+           payload_length <= kMaxPayloadSize &&
+           Get16(header + kWidthOffset) <= kMaxWidth &&
+           Get16(header + kHeightOffset) <= kMaxHeight &&
+           header[kBppOffset] <= kMaxBytesPerPixel;
+}
+
+void EncodeRequest(const RequestMessage& msg, WireMessage& wire) {
+    EncodeHeader(static_cast<uint8_t>(msg.req_type),
+                 static_cast<uint8_t>(msg.req_cmd), 0, wire.data);
+    Put32(wire.data + kCreditsOffset, msg.credits);
+    wire.size = kWireHeaderSize;
+}
+
+bool DecodeRequest(const WireMessage& wire, RequestMessage& msg) {
+    uint32_t payload_length{0};
+    if (wire.size < kWireHeaderSize || !DecodeWireHeader(wire.data, payload_length) ||
+        wire.size != kWireHeaderSize + payload_length) {
+        return false;
+    }
+    const uint8_t type{wire.data[kTypeOffset]};
+    msg.req_type = type < REQUEST_UNKNOWN ? static_cast<RequestType>(type) : REQUEST_UNKNOWN;
+    msg.req_cmd = static_cast<RequestCmd>(wire.data[kCodeOffset]);
+    msg.credits = Get32(wire.data + kCreditsOffset);
+    return true;
+}
+
+uint8_t* EncodeResponseHeader(const ResponseHeader& msg,
+                              uint32_t payload_length,
+                              WireMessage& wire) {
+    uint8_t* header = wire.data;
+    EncodeHeader(static_cast<uint8_t>(msg.req_type),
+                 static_cast<uint8_t>(msg.req_status), payload_length, header);
+    header[kBppOffset] = static_cast<uint8_t>(msg.bpp);
+    Put16(header + kWidthOffset, static_cast<uint16_t>(msg.width));
+    Put16(header + kHeightOffset, static_cast<uint16_t>(msg.height));
+    Put16(header + kEncodingOffset, static_cast<uint16_t>(msg.encoding));
+    Put64(header + kFrameIdOffset, msg.frame_id);
+    const double temperature{msg.sensor_temperature > 0.0 ? msg.sensor_temperature + 0.5 : 0.0};
+    Put32(header + kTemperatureOffset, static_cast<uint32_t>(temperature));
+    wire.size = kWireHeaderSize + payload_length;
+    return header + kWireHeaderSize;
+}
+
+void EncodeStatusResponse(RequestType type, RequestStatus status, WireMessage& wire) {
+    ResponseHeader header;
+    header.req_type = type;
+    header.req_status = status;
+    EncodeResponseHeader(header, 0, wire);
+}
+
+void EncodeResponse(const ResponseMessage& msg, WireMessage& wire) {
+    uint32_t payload_length{0};
+    if (msg.req_type == REQUEST_FRAME && msg.req_status == STATUS_FRAME_READY) {
+        payload_length = std::min<uint32_t>(msg.width * msg.height * msg.bpp, kMaxPayloadSize);
+        if (msg.encoding == ENCODING_LOSSLESS && msg.bpp == 2 &&
+            EncodeFrameU16(msg, reinterpret_cast<const uint16_t*>(msg.frame), wire)) {
+            return;
+        }
+    }
+    else if (msg.req_type == REQUEST_I2C && msg.req_status == STATUS_I2C_SUCCEED) {
+        payload_length = kI2CPayloadSize;
+    }
+
+    ResponseHeader header = msg;
+    header.encoding = ENCODING_RAW;
+    uint8_t* payload = EncodeResponseHeader(header, payload_length, wire);
+    if (msg.req_type == REQUEST_I2C) {
+        if (payload_length > 0) {
+            uint32_t result{0};
+            memcpy(&result, msg.frame, sizeof(result));
+            Put32(payload, result);
+        }
+    }
+    else if (msg.bpp == 2) {
+        EncodePixelsU16(reinterpret_cast<const uint16_t*>(msg.frame), payload_length / 2, payload);
+    }
+    else {
+        memcpy(payload, msg.frame, payload_length);
+    }
+}
+
+bool DecodeResponse(const WireMessage& wire, ResponseMessage& msg) {
+    uint32_t payload_length{0};
+    if (wire.size < kWireHeaderSize || !DecodeWireHeader(wire.data, payload_length) ||
+        wire.size != kWireHeaderSize + payload_length) {
+        return false;
+    }
+    const uint8_t* header = wire.data;
+    const uint8_t type{header[kTypeOffset]};
+    msg.req_type = type < REQUEST_UNKNOWN ? static_cast<RequestType>(type) : REQUEST_UNKNOWN;
+    msg.req_status = static_cast<RequestStatus>(header[kCodeOffset]);
+    msg.bpp = header[kBppOffset];
+    msg.width = Get16(header + kWidthOffset);
+    msg.height = Get16(header + kHeightOffset);
+    msg.frame_id = Get64(header + kFrameIdOffset);
+    msg.sensor_temperature = Get32(header + kTemperatureOffset);
+    msg.encoding = static_cast<FrameEncoding>(Get16(header + kEncodingOffset));
+
+    const uint8_t* payload = header + kWireHeaderSize;
+    if (msg.req_type == REQUEST_I2C) {
+        if (payload_length == kI2CPayloadSize) {
+            const uint32_t result{Get32(payload)};
+            memcpy(msg.frame, &result, sizeof(result));
+        }
+        return payload_length == 0 || payload_length == kI2CPayloadSize;
+    }
+    if (payload_length == 0) {
+        return true;
+    }
+
+    // Frame geometry, bounded by the header decode (size_t, no wrap around)
+    if (msg.bpp != 1 && msg.bpp != kMaxBytesPerPixel) {
+        return false;
+    }
+    const size_t num_pixels{static_cast<size_t>(msg.width) * msg.height};
+    if (msg.encoding == ENCODING_LOSSLESS) {
+        return msg.bpp == 2 && num_pixels * sizeof(uint16_t) <= sizeof(msg.frame) &&
+               DecompressFrameU16(payload, payload_length, msg.width, msg.height,
+                                  reinterpret_cast<uint16_t*>(msg.frame));
+    }
+    if (msg.encoding != ENCODING_RAW || payload_length != num_pixels * msg.bpp) {
+        return false;
+    }
+    if (msg.bpp == 2) {
+        auto pixels = reinterpret_cast<uint16_t*>(msg.frame);
+        for (size_t i = 0; i < payload_length / 2; ++i) {
+            pixels[i] = Get16(payload + 2 * i);
+        }
+    }
+    else {
+        memcpy(msg.frame, payload, payload_length);
+    }
+    return true;
+}
+
+bool EncodeFrameU16(const ResponseHeader& msg, const uint16_t* pixels, WireMessage& wire) {
+    uint8_t* payload = wire.data + kWireHeaderSize;
+    const size_t raw_size{static_cast<size_t>(msg.width) * msg.height * 2};
+    const size_t size{CompressFrameU16(pixels, msg.width, msg.height, payload,
+                                       std::min(raw_size - 1, kMaxPayloadSize))};
+    if (size == 0) {
+        return false;
+    }
+    ResponseHeader header = msg;
+    header.bpp = 2;
+    header.encoding = ENCODING_LOSSLESS;
+    EncodeResponseHeader(header, static_cast<uint32_t>(size), wire);
+    return true;
+}
+
+void EncodePixelsU16(const uint16_t* pixels, size_t num_pixels, uint8_t* payload) {
+    for (size_t i = 0; i < num_pixels; ++i) {
+        Put16(payload + 2 * i, pixels[i]);
+    }
+}
+
+bool SendWire(int socketHandle, const WireMessage& wire, int timeout_ms) {
+    iovec part;
+    part.iov_base = const_cast<uint8_t*>(wire.data);
+    part.iov_len = wire.size;
+    return SendData(socketHandle, &part, 1, timeout_ms);
+}
+
+bool ReceiveWire(int socketHandle, WireMessage& wire, int timeout_ms) {
+
+    // The payload shares the timeout with the header
+    const auto start = std::chrono::steady_clock::now();
+    if (!ReceiveData(socketHandle, wire.data, kWireHeaderSize, timeout_ms)) {
+        return false;
+    }
+    uint32_t payload_length{0};
+    if (!DecodeWireHeader(wire.data, payload_length)) {
+        std::cerr << "Error: invalid message header (magic " << Get16(wire.data + kMagicOffset)
+                  << ", version " << static_cast<int>(wire.data[kVersionOffset])
+                  << ", payload " << payload_length << " bytes)" << std::endl;
+        throw std::runtime_error("Invalid message.");
+    }
+    wire.size = kWireHeaderSize + payload_length;
+    int payload_timeout_ms{timeout_ms};
+    if (timeout_ms >= 0) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        payload_timeout_ms = std::max(0, timeout_ms - static_cast<int>(elapsed));
+    }
+    return ReceiveData(socketHandle, wire.data + kWireHeaderSize, payload_length, payload_timeout_ms);
+}
+
+bool SendMessage(int socketHandle, const RequestMessage& msg, int timeout_ms) {
+    WireMessage wire;
+    EncodeRequest(msg, wire);
+    return SendWire(socketHandle, wire, timeout_ms);
+}
+
+bool SendMessage(int socketHandle, const ResponseMessage& msg, int timeout_ms) {
+    WireMessage wire;
+    EncodeResponse(msg, wire);
+    return SendWire(socketHandle, wire, timeout_ms);
+}
+
+bool ReceiveMessage(int socketHandle, RequestMessage& msg, int timeout_ms) {
+    WireMessage wire;
+    if (!ReceiveWire(socketHandle, wire, timeout_ms)) {
+        return false;
+    }
+    if (!DecodeRequest(wire, msg)) {
+        throw std::runtime_error("Invalid message.");
+    }
+    return true;
+}
+
+bool ReceiveMessage(int socketHandle, ResponseMessage& msg, int timeout_ms) {
+    WireMessage wire;
+    if (!ReceiveWire(socketHandle, wire, timeout_ms)) {
+        return false;
+    }
+    if (!DecodeResponse(wire, msg)) {
+        std::cerr << "Error: invalid response payload (" << wire.size - kWireHeaderSize
+                  << " bytes)" << std::endl;
+        throw std::runtime_error("Invalid message.");
+    }
+    return true;
+}
@@ -0,0 +1,264 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// LePi
+#include <FrameCodec.h>
+
+// C/C++
+#include <cstring>
+
+
+// Residuals whose Rice quotient reaches kEscapeLength are sent as kEscapeLength
+// zeros, a one, and the mapped residual on kEscapeBits bits (bounds the code
+// length of outliers, e.g. dead pixels)
+constexpr uint32_t kEscapeLength{24};
+constexpr uint32_t kEscapeBits{17};
+constexpr uint32_t kMaxRiceParameter{16};
+
+// Residual statistics are halved every kStatsReset pixels, so the Rice
+// parameter follows the local image content
+constexpr uint32_t kStatsReset{32};
+
+namespace {
+
+/**
+ * @brief Adaptive Rice parameter, from the running mean of the mapped residuals
+ */
+class RiceState {
+public:
+    inline uint32_t Parameter() const {
+        uint32_t k{0};
+        while ((count_ << k) < sum_ && k < kMaxRiceParameter) {
+            ++k;
+        }
+        return k;
+    }
+
+    inline void Update(uint32_t value) {
+        sum_ += value;
+        if (++count_ == kStatsReset) {
+            sum_ >>= 1;
+            count_ >>= 1;
+        }
+    }
+
+private:
+    uint32_t sum_{4};
+    uint32_t count_{1};
+};
+
+/**
+ * @brief MSB first bit writer
+ */
+class BitWriter {
+public:
+    BitWriter(uint8_t* data, size_t capacity)
+            : data_{data}, capacity_{capacity} {}
+
+    // Writes up to 48 bits
+    inline bool Put(uint64_t value, uint32_t num_bits) {
+        bits_ = (bits_ << num_bits) | value;
+        num_bits_ += num_bits;
+        while (num_bits_ >= 8) {
+            if (size_ == capacity_) {
+                return false;
+            }
+            num_bits_ -= 8;
+            data_[size_++] = static_cast<uint8_t>(bits_ >> num_bits_);
+        }
+        return true;
+    }
+
+    // Pads the last byte with zeros
+    inline bool Flush() {
+        return num_bits_ == 0 || Put(0, 8 - num_bits_);
+    }
+
+    inline size_t Size() const { return size_; }
+
+private:
+    uint8_t* data_;
+    size_t capacity_;
+    size_t size_{0};
+    uint64_t bits_{0};
+    uint32_t num_bits_{0};
+};
+
+/**
+ * @brief MSB first bit reader. Reads past the end return zeros, and are
+ *        reported by Overrun. Refill once before reading up to 57 bits.
+ */
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size)
+            : data_{data}, size_{size} {}
+
+    // Number of leading zeros, at most max_zeros (the stop bit is not consumed)
+    inline uint32_t Zeros(uint32_t max_zeros) {
+        uint32_t zeros{bits_ == 0 ? 64u : static_cast<uint32_t>(__builtin_clzll(bits_))};
+        zeros = zeros < max_zeros ? zeros : max_zeros;
+        Skip(zeros);
+        return zeros;
+    }
+
+    // Reads up to 32 bits
+    inline uint32_t Get(uint32_t num_bits) {
+        if (num_bits == 0) {
+            return 0;
+        }
+        const uint32_t value{static_cast<uint32_t>(bits_ >> (64 - num_bits))};
+        Skip(num_bits);
+        return value;
+    }
+
+    inline bool Overrun() const { return consumed_ > size_ * 8; }
+
+    // Keeps at least 57 bits in the buffer (left aligned)
+    inline void Refill() {
+        while (num_bits_ <= 56) {
+            const uint64_t byte{position_ < size_ ? data_[position_] : 0u};
+            bits_ |= byte << (56 - num_bits_);
+            num_bits_ += 8;
+            ++position_;
+        }
+    }
+
+private:
+    inline void Skip(uint32_t num_bits) {
+        bits_ = num_bits < 64 ? bits_ << num_bits : 0;
+        num_bits_ -= num_bits;
+        consumed_ += num_bits;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_{0};
+    size_t consumed_{0};
+    uint64_t bits_{0};
+    uint32_t num_bits_{0};
+};
+
+/**
+ * @brief LOCO-I median predictor
+ * @param a  Left pixel
+ * @param b  Upper pixel
+ * @param c  Upper-left pixel
+ */
+inline int32_t Predict(int32_t a, int32_t b, int32_t c) {
+    const int32_t min_ab{a < b ? a : b};
+    const int32_t max_ab{a < b ? b : a};
+    if (c >= max_ab) {
+        return min_ab;
+    }
+    if (c <= min_ab) {
+        return max_ab;
+    }
+    return a + b - c;
+}
+
+/**
+ * @brief Prediction of pixel (x, y), from the pixels already coded
+ */
+inline int32_t PredictPixel(const uint16_t* pixels, uint32_t width, uint32_t x, uint32_t y) {
+    const uint16_t* pixel = pixels + y * width + x;
+    if (y == 0) {
+        return x == 0 ? 0 : pixel[-1];
+    }
+    if (x == 0) {
+        return pixel[-static_cast<int32_t>(width)];
+    }
+    return Predict(pixel[-1], pixel[-static_cast<int32_t>(width)],
+                   pixel[-static_cast<int32_t>(width) - 1]);
+}
+
+} // namespace
+
+size_t CompressFrameU16(const uint16_t* pixels,
+                        uint32_t width,
+                        uint32_t height,
+                        uint8_t* data,
+                        size_t capacity) {
+
+    BitWriter writer(data, capacity);
+    RiceState state;
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+
+            // Signed residual, mapped to 0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ...
+            const int32_t residual{pixels[y * width + x] - PredictPixel(pixels, width, x, y)};
+            const uint32_t value{residual < 0 ? (static_cast<uint32_t>(-residual) << 1) - 1
+                                              : static_cast<uint32_t>(residual) << 1};
+
+            // Rice code: quotient in unary (zeros, then a one), remainder on k bits
+            const uint32_t k{state.Parameter()};
+            const uint32_t quotient{value >> k};
+            bool written{false};
+            if (quotient < kEscapeLength) {
+                written = writer.Put((1ull << k) | (value & ((1u << k) - 1)), quotient + 1 + k);
+            }
+            else {
+                written = writer.Put((1ull << kEscapeBits) | value, kEscapeLength + 1 + kEscapeBits);
+            }
+            if (!written) {
+                return 0;
+            }
+            state.Update(value);
+        }
+    }
+    return writer.Flush() ? writer.Size() : 0;
+}
+
+bool DecompressFrameU16(const uint8_t* data,
+                        size_t size,
+                        uint32_t width,
+                        uint32_t height,
+                        uint16_t* pixels) {
+
+    BitReader reader(data, size);
+    RiceState state;
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            // A code is at most kEscapeLength + 1 + kEscapeBits bits
+            reader.Refill();
+            const uint32_t k{state.Parameter()};
+            const uint32_t quotient{reader.Zeros(kEscapeLength)};
+            reader.Get(1);  // stop bit
+            const uint32_t value{quotient < kEscapeLength ? (quotient << k) | reader.Get(k)
+                                                          : reader.Get(kEscapeBits)};
+            const int32_t residual{(value & 1) ? -static_cast<int32_t>((value + 1) >> 1)
+                                               : static_cast<int32_t>(value >> 1)};
+            const int32_t pixel{PredictPixel(pixels, width, x, y) + residual};
+            if (pixel < 0 || pixel > 0xFFFF || reader.Overrun()) {
+                return false;
+            }
+            pixels[y * width + x] = static_cast<uint16_t>(pixel);
+            state.Update(value);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,174 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <Connection.h>
+#include <FramePublisher.h>
+#include <LeptonUnpack.h>
+
+// C/C++
+#include <unistd.h>
+
+
+/**
+ * @brief Encode a frame response, in the requested pixel depth/encoding. The
+ *        pixels are scaled/written/compressed straight into the response
+ *        payload (a frame that does not compress is sent uncompressed).
+ */
+static void FrameResponse(WireMessage& msg, const LeptonFrame& frame, RequestCmd cmd,
+                          uint32_t width, uint32_t height) {
+    const std::vector<uint16_t>& pixels = frame.pixels;
+    ResponseHeader header;
+    header.req_type = REQUEST_FRAME;
+    header.req_status = STATUS_FRAME_READY;
+    header.width = width;
+    header.height = height;
+    header.bpp = cmd == CMD_FRAME_U8 ? 1 : 2;
+    header.frame_id = frame.frame_id;
+    header.sensor_temperature = frame.sensor_temperature;
+    if (cmd == CMD_FRAME_U16_COMPRESSED && EncodeFrameU16(header, pixels.data(), msg)) {
+        return;
+    }
+    uint8_t* payload = EncodeResponseHeader(
+        header, static_cast<uint32_t>(pixels.size() * header.bpp), msg);
+    if (cmd == CMD_FRAME_U8) {
+        uint16_t minValue{0};
+        uint16_t maxValue{0};
+        LeptonMinMax(pixels.data(), pixels.size(), minValue, maxValue);
+        LeptonScale8(pixels.data(), pixels.size(), minValue, maxValue, payload);
+    }
+    else {
+        EncodePixelsU16(pixels.data(), pixels.size(), payload);
+    }
+}
+
+FramePublisher::FramePublisher(MessageServer& server, LeptonCamera& camera,
+                               std::chrono::milliseconds frame_timeout)
+        : server_(server),
+          camera_(camera),
+          frame_timeout_(frame_timeout),
+          requests_(server.MaxClients()) {
+}
+
+bool FramePublisher::HandleRequest(int client, const RequestMessage& request) {
+    FrameRequest& frame_request = requests_[client];
+    switch (request.req_type) {
+        case REQUEST_FRAME:
+            // Answered on the next frame (or after the frame timeout)
+            frame_request.waiting = true;
+            frame_request.cmd = request.req_cmd;
+            frame_request.time = std::chrono::steady_clock::now();
+            return true;
+        case REQUEST_SUBSCRIBE:
+            frame_request.subscribed = true;
+            frame_request.cmd = request.req_cmd;
+            frame_request.flow_control = request.credits > 0;
+            frame_request.credits = request.credits;
+            return true;
+        case REQUEST_UNSUBSCRIBE:
+            frame_request.subscribed = false;
+            return true;
+        case REQUEST_CREDIT:
+            frame_request.credits += request.credits;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void FramePublisher::RemoveClient(int client) {
+    requests_[client] = FrameRequest();
+}
+
+size_t FramePublisher::Publish() {
+    uint64_t events{0};
+    if (read(camera_.frameEventFd(), &events, sizeof(events)) < 0 || !camera_.hasFrame()) {
+        return 0;
+    }
+
+    // Build each frame response once, and fan it out
+    LeptonFrameLease frame;
+    WireMessage* frame_u8{nullptr};
+    WireMessage* frame_u16{nullptr};
+    WireMessage* frame_compressed{nullptr};
+    size_t sent{0};
+    for (size_t client = 0; client < requests_.size(); ++client) {
+        FrameRequest& request = requests_[client];
+        const bool push{request.subscribed &&
+                        (!request.flow_control || request.credits > 0)};
+        if (!request.waiting && !push) {
+            continue;
+        }
+        if (!frame) {
+            frame = camera_.leaseFrame();
+        }
+        WireMessage*& resp_msg = request.cmd == CMD_FRAME_U8 ? frame_u8 :
+                                 request.cmd == CMD_FRAME_U16_COMPRESSED ? frame_compressed :
+                                 frame_u16;
+        if (!resp_msg) {
+            resp_msg = server_.NewMessage();
+            if (!resp_msg) {
+                continue; // all responses in flight, wait for the next frame
+            }
+            FrameResponse(*resp_msg, *frame, request.cmd, camera_.width(), camera_.height());
+        }
+        server_.Send(static_cast<int>(client), resp_msg);
+        request.waiting = false;
+        if (push && request.flow_control) {
+            --request.credits;
+        }
+        ++sent;
+    }
+    if (frame_u8) {
+        server_.Release(frame_u8);
+    }
+    if (frame_u16) {
+        server_.Release(frame_u16);
+    }
+    if (frame_compressed) {
+        server_.Release(frame_compressed);
+    }
+    return sent;
+}
+
+void FramePublisher::Expire() {
+    const auto now = std::chrono::steady_clock::now();
+    for (size_t client = 0; client < requests_.size(); ++client) {
+        FrameRequest& request = requests_[client];
+        if (!request.waiting || now - request.time < frame_timeout_) {
+            continue;
+        }
+        WireMessage* resp_msg = server_.NewMessage();
+        if (!resp_msg) {
+            continue;
+        }
+        EncodeStatusResponse(REQUEST_FRAME, STATUS_NO_FRAME, *resp_msg);
+        server_.Send(static_cast<int>(client), resp_msg);
+        server_.Release(resp_msg);
+        request.waiting = false;
+    }
+}
@@ -0,0 +1,329 @@
+/**
+ * This file is part of the LePi Project:
+ * https://github.com/cosmac/LePi
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 Andrei Claudiu Cosma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// LePi
+#include <Connection.h>
+#include <MessageServer.h>
+
+// C/C++
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+MessageServer::MessageServer(size_t max_clients, size_t queue_size)
+        : clients_(max_clients),
+          slots_(max_clients * queue_size + kSpareMessages),
+          queue_size_{queue_size} {
+    free_slots_.reserve(slots_.size());
+    for (auto& slot : slots_) {
+        free_slots_.push_back(&slot);
+    }
+    for (auto& client : clients_) {
+        client.queue.reserve(queue_size);
+    }
+    events_.resize(max_clients + kSpareEvents);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        std::cerr << "Server fail to create the epoll instance." << std::endl;
+        std::cerr << "Error: " << strerror(errno) << std::endl;
+        throw std::runtime_error("Server creation failed.");
+    }
+}
+
+MessageServer::~MessageServer() {
+    for (size_t i = 0; i < clients_.size(); ++i) {
+        if (clients_[i].fd >= 0) {
+            CloseClient(static_cast<int>(i));
+        }
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+    close(epoll_fd_);
+}
+
+bool MessageServer::Listen(int port_number) {
+
+    // Create socket
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "Server fail to create the socket." << std::endl;
+        std::cerr << "Error: " << strerror(errno) << std::endl;
+        return false;
+    }
+    const int reuse{1};
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Bind the socket to a local socket address, and listen
+    sockaddr_in socketInfo;
+    memset(&socketInfo, 0, sizeof(socketInfo));
+    socketInfo.sin_family = AF_INET;
+    socketInfo.sin_addr.s_addr = INADDR_ANY;
+    socketInfo.sin_port = htons(static_cast<uint16_t>(port_number));
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&socketInfo), sizeof(socketInfo)) < 0 ||
+        listen(listen_fd_, static_cast<int>(clients_.size())) < 0 ||
+        !AddFd(listen_fd_, EPOLLIN, kListenKey)) {
+        std::cerr << "Server fail to listen for connections." << std::endl;
+        std::cerr << "Error: " << strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+bool MessageServer::Watch(int fd) {
+    return AddFd(fd, EPOLLIN, kWatchKey | static_cast<uint32_t>(fd));
+}
+
+int MessageServer::Poll(int timeout_ms) {
+    const int num_events{epoll_wait(epoll_fd_, events_.data(),
+                                    static_cast<int>(events_.size()), timeout_ms)};
+    if (num_events < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for (int i = 0; i < num_events; ++i) {
+        const uint32_t key{events_[i].data.u32};
+        const uint32_t flags{events_[i].events};
+        if (key == kListenKey) {
+            Accept();
+        }
+        else if ((key & kWatchKey) != 0) {
+            if (on_event_) {
+                on_event_(static_cast<int>(key & ~kWatchKey));
+            }
+        }
+        else {
+            const int client{static_cast<int>(key)};
+            if ((flags & (EPOLLERR | EPOLLHUP)) != 0) {
+                Disconnect(client);
+                continue;
+            }
+            if ((flags & EPOLLOUT) != 0) {
+                Flush(client);
+            }
+            if ((flags & EPOLLIN) != 0 && clients_[client].fd >= 0) {
+                Receive(client);
+            }
+        }
+    }
+    return num_events;
+}
+
+WireMessage* MessageServer::NewMessage() {
+    if (free_slots_.empty()) {
+        return nullptr;
+    }
+    Slot* slot = free_slots_.back();
+    free_slots_.pop_back();
+    slot->refs = 1;
+    return &slot->msg;
+}
+
+void MessageServer::Release(WireMessage* msg) {
+    Unref(ToSlot(msg));
+}
+
+bool MessageServer::Send(int client, WireMessage* msg) {
+    if (client < 0 || static_cast<size_t>(client) >= clients_.size() ||
+        clients_[client].fd < 0) {
+        return false;
+    }
+    Client& c = clients_[client];
+    bool dropped{false};
+    if (c.queue.size() >= queue_size_) {
+        // The queue head may be half sent, it can't be dropped
+        const size_t oldest{c.sent > 0 ? 1u : 0u};
+        if (oldest >= c.queue.size()) {
+            ++dropped_;
+            return false;
+        }
+        Unref(c.queue[oldest]);
+        c.queue.erase(c.queue.begin() + oldest);
+        dropped = true;
+        ++dropped_;
+    }
+    Slot* slot = ToSlot(msg);
+    ++slot->refs;
+    c.queue.push_back(slot);
+    Flush(client);
+    return !dropped;
+}
+
+void MessageServer::Disconnect(int client) {
+    if (client < 0 || static_cast<size_t>(client) >= clients_.size() ||
+        clients_[client].fd < 0) {
+        return;
+    }
+    CloseClient(client);
+    if (on_disconnect_) {
+        on_disconnect_(client);
+    }
+}
+
+void MessageServer::Unref(Slot* slot) {
+    if (--slot->refs == 0) {
+        free_slots_.push_back(slot);
+    }
+}
+
+bool MessageServer::AddFd(int fd, uint32_t events, uint32_t key) {
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.u32 = key;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void MessageServer::SetWriting(int client, bool writing) {
+    Client& c = clients_[client];
+    if (c.writing == writing) {
+        return;
+    }
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | (writing ? EPOLLOUT : 0u);
+    event.data.u32 = static_cast<uint32_t>(client);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &event);
+    c.writing = writing;
+}
+
+void MessageServer::Accept() {
+    while (true) {
+        const int fd{accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)};
+        if (fd < 0) {
+            return; // no more pending connections
+        }
+
+        // Find a free client slot, or refuse the connection
+        int client{-1};
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            if (clients_[i].fd < 0) {
+                client = static_cast<int>(i);
+                break;
+            }
+        }
+        if (client < 0 || !AddFd(fd, EPOLLIN, static_cast<uint32_t>(client))) {
+            std::cerr << "Server refused a client connection (too many clients)." << std::endl;
+            close(fd);
+            continue;
+        }
+        const int no_delay{1};
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        Client& c = clients_[client];
+        c.fd = fd;
+        c.received = 0;
+        c.payload_length = 0;
+        c.sent = 0;
+        c.writing = false;
+    }
+}
+
+void MessageServer::Receive(int client) {
+    Client& c = clients_[client];
+    uint8_t* request = c.request.data;
+    while (c.fd >= 0) {
+        // Header first, then the payload length it announces
+        const size_t expected{c.received < kWireHeaderSize ? kWireHeaderSize :
+                              kWireHeaderSize + c.payload_length};
+        const ssize_t rc{recv(c.fd, request + c.received, expected - c.received, 0)};
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (rc <= 0) {
+            Disconnect(client); // closed by the client, or connection lost
+            return;
+        }
+        c.received += static_cast<size_t>(rc);
+        if (c.received == kWireHeaderSize &&
+            !DecodeWireHeader(request, c.payload_length)) {
+            std::cerr << "Server dropped a client sending an invalid message." << std::endl;
+            Disconnect(client);
+            return;
+        }
+        if (c.received == kWireHeaderSize + c.payload_length) {
+            c.request.size = c.received;
+            c.received = 0;
+            if (on_request_) {
+                on_request_(client, c.request);
+            }
+        }
+    }
+}
+
+void MessageServer::Flush(int client) {
+    Client& c = clients_[client];
+    while (c.fd >= 0 && !c.queue.empty()) {
+        const WireMessage& msg = c.queue.front()->msg;
+        const ssize_t sd{send(c.fd, msg.data + c.sent, msg.size - c.sent, MSG_NOSIGNAL)};
+        if (sd < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            SetWriting(client, true);
+            return;
+        }
+        if (sd < 0) {
+            Disconnect(client);
+            return;
+        }
+        c.sent += static_cast<size_t>(sd);
+        if (c.sent == msg.size) {
+            Unref(c.queue.front());
+            c.queue.erase(c.queue.begin());
+            c.sent = 0;
+        }
+    }
+    if (c.fd >= 0) {
+        SetWriting(client, false);
+    }
+}
+
+void MessageServer::CloseClient(int client) {
+    Client& c = clients_[client];
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c.fd, nullptr);
+    close(c.fd);
+    c.fd = -1;
+    for (Slot* slot : c.queue) {
+        Unref(slot);
+    }
+    c.queue.clear();
+    c.received = 0;
+    c.sent = 0;
+    c.writing = false;
+}